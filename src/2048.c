@@ -9,6 +9,20 @@
 #include "node.h"
 #include "ai.h"
 #include "utils.h"
+#include "metrics.h"
+#include "perf.h"
+#include "trace.h"
+#include "record.h"
+#include "render.h"
+#include "server.h"
+#include "analyze.h"
+#include "variant.h"
+#include "lockstep.h"
+#include "mcts.h"
+#include "tune.h"
+#include "compare.h"
+#include "book.h"
+#include "kernel.h"
 
 /**
  * Setting up terminal to draw the game board
@@ -78,7 +92,41 @@ bool execute_keyboard( uint8_t board[SIZE][SIZE], uint32_t* score, char c){
 
 void print_usage(){
     printf("To run the AI solver: \n");
-    printf("USAGE: ./2048 ai <max/avg> <max_depth> slow\n");
+    printf("USAGE: ./2048 ai <max/avg> <max_depth> [slow] [--perf-counters]"
+        " [--seed <n>] [--record <file>] [--fps <n> | --no-render]"
+        " [--mem-limit <bytes[K/M/G]>] [--size <3/5/6>]"
+        " [--huge-pages <off/thp/explicit>] [--alloc-stats]"
+        " [--weights <file>] [--book <file>] [--generic]"
+        " [--selective] [--node-budget <n>]\n");
+    printf("  --selective alone is bounded by a full tree of max_depth + %d"
+        " levels, --node-budget caps the expanded nodes of every search\n",
+        SELECTIVE_EXTENSIONS);
+    printf("or, to run the AI solver with Monte Carlo tree search: \n");
+    printf("USAGE: ./2048 ai mcts <iterations/time[s/ms]> [--threads <n>]"
+        " [--rollout <random/greedy>] and the options of the AI solver\n");
+    printf("or, to replay and check every game of a record file: \n");
+    printf("USAGE: ./2048 replay <file>\n");
+    printf("or, to answer batches of boards on a Unix socket: \n");
+    printf("USAGE: ./2048 serve <socket> [--threads <n>]\n");
+    printf("or, to analyze every position of a file: \n");
+    printf("USAGE: ./2048 analyze <input> <output> [--depth <n>]"
+        " [--mode <max/avg>] [--threads <n>] [--mem-limit <bytes[K/M/G]>]\n");
+    printf("or, to play many greedy games in lockstep: \n");
+    printf("USAGE: ./2048 selfplay <games> [--lanes <n>] [--seed <n>]"
+        " [--out <file>] [--check]\n");
+    printf("or, to tune the evaluation weights on seeded games: \n");
+    printf("USAGE: ./2048 tune <iterations> [--games <n>] [--depth <n>]"
+        " [--mode <max/avg>] [--threads <n>] [--seed <n>] [--start <file>]"
+        " [--checkpoint <file>] [--out <file>]\n");
+    printf("or, to compare two configurations on paired seeded games: \n");
+    printf("USAGE: ./2048 compare <max/avg>:<depth>[s][:weights]"
+        " <max/avg>:<depth>[s][:weights] [--alpha <a>] [--beta <b>]"
+        " [--delta <d>] [--epsilon <e>] [--target <tile>]"
+        " [--max-games <n>] [--threads <n>] [--seed <n>]\n");
+    printf("or, to build an opening book from seeded games: \n");
+    printf("USAGE: ./2048 book <output> [--games <n>] [--plies <n>]"
+        " [--min-count <n>] [--play-depth <n>] [--depth <n>]"
+        " [--mode <max/avg>] [--threads <n>] [--seed <n>]\n");
     printf("or, to play with the keyboard: \n");
     printf("USAGE: ./2048\n");
 }
@@ -101,13 +149,78 @@ int main(int argc, char *argv[]) {
 	// Variable used for output to file
 	int numberOfGeneratedNode = 0;
 	int numberOfExpandedNode = 0;
+	int numberOfPrunedNode = 0;
 	uint8_t maximumValueInBoard = 0;
 	double seconds = 0; // time for each search
 	double searchTime = 0; // compounding time for total search
+	metrics_t metrics; // per move latency and memory
+	bool perfCounters = false; // hardware counters around every search
+	perf_t perf;
+	int expandedBefore = 0; // expanded nodes before the latest search
+	unsigned int seed = time(NULL); // seed of the spawns of the game
+	char *recordPath = NULL; // binary game record, appended at game over
+	recorder_t recorder;
+	uint8_t moved[SIZE][SIZE]; // board after the move, before the spawn
+	move_t selected_move = left; // latest move of the ai
+	renderer_t renderer; // only redraws the cells that changed
+	bool render = true;
+	int fps = UNLIMITED_FPS;
+	size_t memoryLimit = 0; // bytes of a single search, 0 unlimited
+	int boardSize = SIZE; // other sizes are played by a variant engine
+	bool allocStats = false; // placement of the search memory at game over
+	mcts_t tree; // search of the mcts mode
+	int iterations = 0; // rollouts per move of the mcts mode
+	double budget = 0; // seconds per move of the mcts mode
+	int threads = sysconf(_SC_NPROCESSORS_ONLN); // mcts workers
+	rollout_t rollout = ROLLOUT_RANDOM;
+	weights_t weights = DEFAULT_WEIGHTS; // evaluation of the search
+	const char *engineOption = NULL; // first option only the 4x4 engine takes
+	book_t book; // opening book, consulted before every search
+	bool useBook = false;
+	bool generic = false; // generic engine even if a kernel exists
+	const kernel_t *kernel = NULL; // specialised search of the depth
+	selective_t selective = {false, 0}; // extensions and reductions
+	int extensions, reductions;
+	bool budgetReached;
+	placement_t placement;
+	int i;
 
 	/**
 	 * Parsing command line options
 	 */
+	if (argc == 3 && strcmp(argv[1],"replay")==0) {
+	    return replayRecords(argv[2]);
+	}
+
+	if ((argc == 3 || (argc == 5 && strcmp(argv[3],"--threads")==0)) && 
+		strcmp(argv[1],"serve")==0) {
+	    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	    if (argc == 5) {
+	        sscanf(argv[4], "%d", &threads);
+	    }
+	    return serveMoves(argv[2], threads < 1 ? 1 : threads);
+	}
+
+	if (argc >= 4 && strcmp(argv[1],"analyze")==0) {
+	    return analyzePositions(argc, argv);
+	}
+
+	if (argc >= 3 && strcmp(argv[1],"selfplay")==0) {
+	    return selfPlay(argc, argv);
+	}
+
+	if (argc >= 3 && strcmp(argv[1],"tune")==0) {
+	    return tuneWeights(argc, argv);
+	}
+
+	if (argc >= 4 && strcmp(argv[1],"compare")==0) {
+	    return compareConfigs(argc, argv);
+	}
+
+	if (argc >= 3 && strcmp(argv[1],"book")==0) {
+	    return buildBook(argc, argv);
+	}
+
 	if( argc > 1 && argc < 4 ){
 	    print_usage();
 	    return 0;
@@ -116,21 +229,161 @@ int main(int argc, char *argv[]) {
 	if (argc > 1 ) {	    
 		ai_run = true;
 		initialize_ai();
+		initMetrics(&metrics);
 		if( strcmp(argv[2],"avg")==0 ){
 		    propagation = avg;
 		}
 		else if( strcmp(argv[2],"max")==0 ){
 		    propagation = max;
 		}
+		else if( strcmp(argv[2],"mcts")==0 ){
+		    propagation = mcts;
+		}
 		else{
 		    print_usage();
 		    return 0;
 		}
 
-		sscanf (argv[3],"%d",&max_depth);
+		// Monte Carlo tree search has a budget per move instead of a depth
+		if (propagation == mcts) {
+			if (!parseBudget(argv[3], &iterations, &budget)) {
+			    print_usage();
+			    return 0;
+			}
+		}
+		else {
+			sscanf (argv[3],"%d",&max_depth);
+		}
 		
-		if(argc == 5 && strcmp(argv[4],"slow")==0 )
-		    slow = true;
+		for (i = 4; i < argc; i ++) {
+			// Values are skipped below, the variant engines only take these
+			if (engineOption == NULL && strcmp(argv[i],"--seed")!=0 && 
+			    strcmp(argv[i],"--size")!=0)
+			    engineOption = argv[i];
+
+			if (strcmp(argv[i],"slow")==0)
+			    slow = true;
+			else if (strcmp(argv[i],"--perf-counters")==0)
+			    perfCounters = true;
+			else if (strcmp(argv[i],"--seed")==0 && i + 1 < argc)
+			    sscanf(argv[++ i],"%u",&seed);
+			else if (strcmp(argv[i],"--record")==0 && i + 1 < argc)
+			    recordPath = argv[++ i];
+			else if (strcmp(argv[i],"--fps")==0 && i + 1 < argc)
+			    sscanf(argv[++ i],"%d",&fps);
+			else if (strcmp(argv[i],"--no-render")==0)
+			    render = false;
+			else if (strcmp(argv[i],"--mem-limit")==0 && i + 1 < argc &&
+			    (memoryLimit = parseBytes(argv[++ i])) > 0)
+			    setMemoryLimit(memoryLimit);
+			else if (strcmp(argv[i],"--size")==0 && i + 1 < argc)
+			    sscanf(argv[++ i],"%d",&boardSize);
+			else if (strcmp(argv[i],"--huge-pages")==0 && i + 1 < argc) {
+			    i ++;
+			    if (strcmp(argv[i],"off")==0)
+			        setHugePages(HUGE_OFF);
+			    else if (strcmp(argv[i],"thp")==0)
+			        setHugePages(HUGE_TRANSPARENT);
+			    else if (strcmp(argv[i],"explicit")==0)
+			        setHugePages(HUGE_EXPLICIT);
+			    else {
+			        fprintf(stderr, "--huge-pages takes off, thp or explicit,"
+			            " not %s\n", argv[i]);
+			        return EXIT_FAILURE;
+			    }
+			}
+			else if (strcmp(argv[i],"--alloc-stats")==0)
+			    allocStats = true;
+			else if (strcmp(argv[i],"--threads")==0 && i + 1 < argc)
+			    sscanf(argv[++ i],"%d",&threads);
+			else if (strcmp(argv[i],"--weights")==0 && i + 1 < argc) {
+			    if (!loadWeights(argv[++ i], &weights)) {
+			        fprintf(stderr, "can not read weights %s\n", argv[i]);
+			        return EXIT_FAILURE;
+			    }
+			    setWeights(&weights);
+			}
+			else if (strcmp(argv[i],"--book")==0 && i + 1 < argc) {
+			    if (!(useBook = openBook(&book, argv[++ i]))) {
+			        fprintf(stderr, "can not read book %s\n", argv[i]);
+			        return EXIT_FAILURE;
+			    }
+			    // A book only stands for deeper searches of the same kind
+			    if (book.propagation != propagation || 
+			        book.depth < max_depth) {
+			        fprintf(stderr, "book %s was searched with %s %d, it can"
+			            " not stand for %s %s\n", argv[i], 
+			            book.propagation == avg ? "avg" : "max", book.depth,
+			            argv[2], argv[3]);
+			        closeBook(&book);
+			        return EXIT_FAILURE;
+			    }
+			}
+			else if (strcmp(argv[i],"--generic")==0)
+			    generic = true;
+			else if (strcmp(argv[i],"--selective")==0)
+			    selective.enabled = true;
+			else if (strcmp(argv[i],"--node-budget")==0 && i + 1 < argc) {
+			    selective.enabled = true;
+			    sscanf(argv[++ i],"%d",&selective.nodeBudget);
+			}
+			else if (strcmp(argv[i],"--rollout")==0 && i + 1 < argc)
+			    rollout = strcmp(argv[++ i],"greedy")==0 ? ROLLOUT_GREEDY :
+			        ROLLOUT_RANDOM;
+			else {
+			    print_usage();
+			    return 0;
+			}
+		}
+
+		// Other board sizes play headless on their specialised engine
+		if (boardSize != SIZE && propagation == mcts) {
+			print_usage();
+			return 0;
+		}
+
+		/* The variant engines play headless with the default evaluation on
+		 * one thread, every other option would be silently ignored
+		 */
+		if (boardSize != SIZE && engineOption != NULL) {
+			fprintf(stderr, "--size only takes --seed, %s is an option of the"
+				" 4x4 engine\n", engineOption);
+			if (useBook) {
+				closeBook(&book);
+			}
+			freeMetrics(&metrics);
+			freeAI();
+			return EXIT_FAILURE;
+		}
+		if (boardSize != SIZE) {
+			freeMetrics(&metrics);
+			freeAI();
+			return playVariant(boardSize, propagation, max_depth, seed);
+		}
+
+		// Before initMcts, so that its workers inherit the counters
+		if (perfCounters && !initPerf(&perf)) {
+			fprintf(stderr, "perf_event_open unavailable, counters are empty\n");
+		}
+
+		/* Max searches of a depth with a generated kernel skip the generic
+		 * engine, kernels have a fixed depth so the selective search stays
+		 * generic
+		 */
+		setSelective(&selective);
+		if (!generic && !selective.enabled) {
+			kernel = findKernel(max_depth, propagation);
+		}
+
+		if (propagation == mcts) {
+			initMcts(&tree, iterations, budget, threads, rollout, memoryLimit,
+				seed);
+		}
+
+		if (recordPath != NULL && !openRecorder(&recorder, recordPath)) {
+			fprintf(stderr, "can not open record %s\n", recordPath);
+			return EXIT_FAILURE;
+		}
 	}
 
 
@@ -146,7 +399,13 @@ int main(int argc, char *argv[]) {
 	/**
 	 * Create initial state
 	 */
+	seedRandom(seed);
+	initRenderer(&renderer, render, fps);
 	initBoard(board, &score);
+
+	if (recordPath != NULL) {
+		beginGame(&recorder, seed, max_depth, propagation, RECORD_STATS, board);
+	}
 	
 	while (true) {
 	    /**
@@ -154,16 +413,46 @@ int main(int argc, char *argv[]) {
 	     */
 	    if(ai_run){
 			/**
-		 	* ****** Start timing the clock and process selected move
+		 	* ****** Start timing the wall clock and process selected move
 		 	*/
-	    	clock_t start = clock();
-			move_t selected_move = get_next_move(board, max_depth, propagation,
-				&numberOfGeneratedNode, &numberOfExpandedNode);
-			clock_t end = clock();
+			expandedBefore = numberOfExpandedNode;
+			if (perfCounters) startPerf(&perf);
+	    	double start = wallClock();
+			TRACE_BEGIN(search);
+			if (useBook && lookupBook(&book, board, &selected_move)) {
+				metrics.bookMoves ++;
+			}
+			else {
+				selected_move = propagation == mcts ? mctsMove(&tree, board,
+					&numberOfGeneratedNode, &numberOfExpandedNode) :
+					kernelMove(kernel, board, max_depth, propagation,
+					&numberOfGeneratedNode, &numberOfExpandedNode, 
+					&numberOfPrunedNode);
+
+				// Book moves do not search, so only searches are counted
+				if (selective.enabled && propagation != mcts) {
+					searchSelectivity(&extensions, &reductions, 
+						&budgetReached);
+					recordSelectivity(&metrics, extensions, reductions, 
+						budgetReached);
+				}
+			}
+			TRACE_END(search, "get_next_move", metrics.nLatency);
+			double end = wallClock();
+			if (perfCounters) stopPerf(&perf, metrics.nLatency, 
+				numberOfExpandedNode - expandedBefore);
 			
 			// Seconds store number of seconds of searching the graph
-			seconds = (double) (end - start) / CLOCKS_PER_SEC;
+			seconds = end - start;
 			searchTime += seconds; // calculate compound for total search
+			if (propagation == mcts) {
+				recordMove(&metrics, seconds, tree.nodes.reserved, 
+					tree.degraded);
+			}
+			else {
+				recordMove(&metrics, seconds, searchMemory(), 
+					searchDegraded());
+			}
 		
 			/**
 		 	* Execute the selected action
@@ -183,6 +472,7 @@ int main(int argc, char *argv[]) {
 				break;
 		    	}
 		    	drawBoard(board,score);
+		    	invalidateRenderer(&renderer);
 			}
 			if (c=='r') {
 		    	printf("       RESTART? (y/n)       \n");
@@ -191,6 +481,7 @@ int main(int argc, char *argv[]) {
 				initBoard(board, &score);
 		    	}
 		    	drawBoard(board,score);
+		    	invalidateRenderer(&renderer);
 			}
 	    }		
 
@@ -200,14 +491,23 @@ int main(int argc, char *argv[]) {
 	     */
 	    if (success) {
 		
-			drawBoard(board,score);
+			renderFrame(&renderer, board, score, false);
 
 			if(slow) usleep(150000); //0.15 seconds
 
+			copyBoard(moved, board);
 			addRandom(board);
-			drawBoard(board,score);
+			renderFrame(&renderer, board, score, false);
+
+			if (recordPath != NULL) {
+				recordTurn(&recorder, selected_move, moved, board, 
+					numberOfExpandedNode - expandedBefore, 
+					seconds * MICROSECOND);
+			}
 		
 			if (gameEnded(board)) {
+				// Final board is always shown, whatever the frame cap
+				renderFrame(&renderer, board, score, true);
 		    	printf("         GAME OVER          \n");
 		    	break;
 			}
@@ -221,10 +521,40 @@ int main(int argc, char *argv[]) {
 		maximumValueInBoard = maximumTile(board);
 
 		printOutput(max_depth, numberOfGeneratedNode, numberOfExpandedNode, 
-		    searchTime, maximumValueInBoard, score);
+		    numberOfPrunedNode, searchTime, maximumValueInBoard, score);
+		if (recordPath != NULL) {
+			endGame(&recorder, score);
+			closeRecorder(&recorder);
+		}
+
+		printMetrics(&metrics, max_depth, propagation, numberOfGeneratedNode, 
+			numberOfExpandedNode, numberOfPrunedNode, searchTime, 
+			maximumValueInBoard, score);
+		freeMetrics(&metrics);
+
+		if (perfCounters) {
+			printPerf(&perf);
+			freePerf(&perf);
+		}
+
+		// Timeline of the game, only when built with make trace
+		TRACE_WRITE("trace.json");
+
+		// Backing and NUMA placement of the memory of the search
+		if (allocStats) {
+			memset(&placement, 0, sizeof(placement));
+			searchPlacement(&placement);
+			printMemoryStats("memory_stats.json", &placement);
+		}
 
 		// Free heap array used by AI 
 		freeAI();
+		if (propagation == mcts) {
+			freeMcts(&tree);
+		}
+		if (useBook) {
+			closeBook(&book);
+		}
 	}
 	
 	setBufferedInput(true);
@@ -238,13 +568,14 @@ int main(int argc, char *argv[]) {
  * @param max_depth Maximum depth of expansion
  * @param numberOfGeneratedNode Number of nodes that are applied action
  * @param numberOfExpandedNode Number of nodes out of heap
+ * @param numberOfPrunedNode Number of nodes skipped by branch and bound
  * @param searchTime Search time until game over
  * @param maxTile Maximum value in board
  * @param score Score when game over
  */
 void
 printOutput(int max_depth, int numberOfGeneratedNode, int numberOfExpandedNode, 
-	double searchTime, uint8_t maxTile, uint32_t score) {
+	int numberOfPrunedNode, double searchTime, uint8_t maxTile, uint32_t score) {
 	/** File open */
 	FILE *fp = fopen("output.txt", "w");
 	assert(fp != NULL);
@@ -256,7 +587,7 @@ printOutput(int max_depth, int numberOfGeneratedNode, int numberOfExpandedNode,
 	fprintf(fp, "Time = %.2f seconds\n", searchTime);
 
 	// Be careful with the expanded / second as second might be 0
-	if (abs(searchTime - 0) < EPSILON) {
+	if (fabs(searchTime - 0) < EPSILON) {
 		fprintf(fp, "Expanded/Second = %.2f \n", numberOfExpandedNode / 
 			EPSILON);
 	}
@@ -267,6 +598,7 @@ printOutput(int max_depth, int numberOfGeneratedNode, int numberOfExpandedNode,
 
 	fprintf(fp, "max_tile = %d \n", (int) pow(BASE, maxTile));
 	fprintf(fp, "Score = %d\n", score);
+	fprintf(fp, "Pruned = %d \n", numberOfPrunedNode);
 	
 	fclose(fp);
 }
@@ -11,25 +11,48 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <math.h>
+#include <string.h>
+#include <limits.h>
 
 #include "ai.h"
 #include "utils.h"
 #include "priority_queue.h"
+#include "trace.h"
 
-/** Frontier heap */
-struct heap h;
+/** Search used by get_next_move, one per thread so threads can search 
+ * concurrently after each one called initialize_ai
+ */
+__thread search_t threadSearch;
+
+/** Bytes held by the latest search finished on this thread, arena of the
+ * nodes and heap
+ */
+__thread size_t lastSearchMemory = 0;
+
+/** Whether the latest search finished on this thread hit its memory limit */
+__thread bool lastSearchDegraded = false;
+
+/** Extensions, reductions and node budget of the latest search finished on
+ * this thread
+ */
+__thread int lastSearchExtensions = 0;
+__thread int lastSearchReductions = 0;
+__thread bool lastSearchBudget = false;
+
+/** Xorshift state of the tie breaks of this thread, 0 to use rand() */
+__thread uint32_t tieState = 0;
 
 /***************************MAIN*AI*FUNCTION*********************************/
 
-/** Initialize the ai by initialising the heap */
+/** Initialize the ai by initialising the search of this thread */
 void initialize_ai(){
-	heap_init(&h);
+	initSearch(&threadSearch);
 }
 
 /** Free the heap that are used by AI */
 void
 freeAI() {
-	free(h.heaparr);
+	freeSearch(&threadSearch);
 }
 
 /** Find best action by building all possible paths up to depth max_depth
@@ -39,69 +62,464 @@ freeAI() {
  * @param propagation Type of propagation, max or avg
  * @param numberOfGeneratedNode Calculate total number of generated node
  * @param numberOfExpandedNode Calculate total number of expanded node
+ * @param numberOfPrunedNode Calculate total number of pruned node (max only)
  * @return best_action Move that lead to highest score
  */
 move_t 
 get_next_move( uint8_t board[SIZE][SIZE], int max_depth, 
 	propagation_t propagation, int *numberOfGeneratedNode,
-	int *numberOfExpandedNode ){
-	move_t best_action;
+	int *numberOfExpandedNode, int *numberOfPrunedNode ){
+	return searchMove(board, max_depth, propagation, NULL, NULL, 
+		numberOfGeneratedNode, numberOfExpandedNode, numberOfPrunedNode);
+}
+
+/** Same search as get_next_move, also giving the value of every root move.
+ * Under max propagation the values of moves that can not be the best are
+ * lower bounds, since their subtrees might have been pruned
+ * @param board The condition of the current board
+ * @param max_depth Maximum depth that will be expanded
+ * @param propagation Type of propagation, max or avg
+ * @param values Value of every move, 0 if illegal (can be NULL)
+ * @param legalMoves Bit i is set if move i is legal (can be NULL)
+ * @param numberOfGeneratedNode Calculate total number of generated node
+ * @param numberOfExpandedNode Calculate total number of expanded node
+ * @param numberOfPrunedNode Calculate total number of pruned node (max only)
+ * @return best_action Move that lead to highest score, left if none legal
+ */
+move_t 
+searchMove(uint8_t board[SIZE][SIZE], int max_depth, 
+	propagation_t propagation, uint32_t values[NUMBER_OF_MOVES], 
+	uint8_t *legalMoves, int *numberOfGeneratedNode, 
+	int *numberOfExpandedNode, int *numberOfPrunedNode) {
+	search_t *search = &threadSearch;
 
 	// Handle if it is not given any depth at all, move randomly
 	if (max_depth == INITIAL) {
-		return (rand() % NUMBER_OF_MOVES);
+		currentBestMove(NULL, values, legalMoves);
+		return tieBreak(NUMBER_OF_MOVES);
 	}
 
-	// Initial size of explored, sum of 4^0 + 4 ^ 1 +... (closed formula used)
-	int maximumNode = (int) ((SIZE * ((pow(SIZE, max_depth) - NEXT_LEVEL) / 
-		(SIZE - NEXT_LEVEL))) + NEXT_LEVEL);
+	startSearch(search, board, max_depth, propagation);
+	while (!stepSearch(search, INT_MAX));
+
+	// Decide best action best on greatest score, if tie select randomly
+	move_t best_action = currentBestMove(search, values, legalMoves);
+
+	*numberOfGeneratedNode += search -> generated;
+	*numberOfExpandedNode += search -> expanded;
+	*numberOfPrunedNode += search -> pruned;
+
+	finishSearch(search);
+	return best_action;
+}
+
+/** Memory used by the latest search
+ * @return bytes Peak bytes of the latest search finished on this thread
+ */
+size_t
+searchMemory() {
+	return lastSearchMemory;
+}
 
-	// Used to store depth 1 possible move
-	node_t *decisionMove[NUMBER_OF_MOVES];
-	int indexDecide = 0;
+/** Record a search that did not go through the search of this thread, so
+ * that searchMemory and searchDegraded describe it and not the latest
+ * search of this thread
+ * @param bytes Peak bytes held by that search
+ */
+void
+recordSearch(size_t bytes) {
+	lastSearchMemory = bytes;
+	lastSearchDegraded = false;
+	lastSearchExtensions = lastSearchReductions = 0;
+	lastSearchBudget = false;
+}
+
+/** Where the pages of the arena and heap of this thread are
+ * @param placement Counts per node, increased
+ */
+void
+searchPlacement(placement_t *placement) {
+	arenaPlacement(&threadSearch.nodes, placement);
+	samplePlacement(threadSearch.frontier.heaparr, 
+		threadSearch.frontier.size * sizeof(frontier_t), placement);
+}
+
+/** Whether the latest search ran out of memory budget and stopped widening
+ * @return bool True if the latest search finished on this thread degraded
+ */
+bool
+searchDegraded() {
+	return lastSearchDegraded;
+}
+
+/** Limit the memory of the searches of get_next_move on this thread
+ * @param bytes Budget of the arena of the nodes and heap, 0 for unlimited
+ */
+void
+setMemoryLimit(size_t bytes) {
+	threadSearch.memoryLimit = bytes;
+}
+
+/** Weights of the evaluation of the searches of get_next_move on this 
+ * thread
+ * @param weights Weights of the evaluation terms
+ */
+void
+setWeights(weights_t *weights) {
+	threadSearch.weights = *weights;
+}
+
+/** Weights of the evaluation of the searches on this thread
+ * @return weights Weights given to setWeights, the defaults otherwise
+ */
+weights_t
+*searchWeights() {
+	return &threadSearch.weights;
+}
+
+/** Break the ties of the searches of get_next_move on this thread from a
+ * seed instead of the global rand(), which threads share and interleave
+ * @param seed Non zero xorshift state, 0 to go back to rand()
+ */
+void
+setTieBreak(uint32_t seed) {
+	tieState = seed;
+}
+
+/** Random index of a tie, from the seed of setTieBreak if there is one
+ * @param n Number of tied moves
+ * @return index Index below n
+ */
+int
+tieBreak(int n) {
+	return (tieState ? nextRandom(&tieState) : (uint32_t) rand()) % n;
+}
+
+/** Extensions and reductions of the searches of get_next_move on this 
+ * thread
+ * @param selective Whether they are enabled and their node budget
+ */
+void
+setSelective(selective_t *selective) {
+	threadSearch.selective = *selective;
+}
+
+/** What the selective search did in the latest search
+ * @param extensions Nodes searched one level deeper
+ * @param reductions Nodes searched one level shallower
+ * @param budgetReached Whether it stopped widening at its node budget
+ */
+void
+searchSelectivity(int *extensions, int *reductions, bool *budgetReached) {
+	*extensions = lastSearchExtensions;
+	*reductions = lastSearchReductions;
+	*budgetReached = lastSearchBudget;
+}
+
+/***************************STEP*SEARCH*FUNCTION******************************/
+
+/** Initialise a search before its first start
+ * @param search Search to be initialised
+ */
+void
+initSearch(search_t *search) {
+	heap_init(&search -> frontier);
+	initArena(&search -> nodes, ARENA_MAX_CHUNK);
+	search -> countExplored = 0;
+	search -> done = true;
+	search -> memoryLimit = 0;
+	search -> degraded = false;
+	search -> selective.enabled = false;
+	search -> selective.nodeBudget = 0;
+
+	weights_t defaults = DEFAULT_WEIGHTS;
+	search -> weights = defaults;
+}
+
+/** Start searching a board, the root is expanded straight away so the 
+ * heap only contain its children
+ * @param search Initialised search, finished if it was started before
+ * @param board The condition of the current board
+ * @param max_depth Maximum depth that will be expanded, at least 1
+ * @param propagation Type of propagation, max or avg
+ */
+void
+startSearch(search_t *search, uint8_t board[SIZE][SIZE], int max_depth,
+	propagation_t propagation) {
+	assert(max_depth > INITIAL && search -> countExplored == INITIAL);
+
+	search -> max_depth = max_depth;
+	search -> propagation = propagation;
+	search -> indexDecide = 0;
+	search -> generated = search -> expanded = search -> pruned = 0;
+	search -> done = false;
+	search -> degraded = false;
+	search -> degradedAt = 0;
+	search -> budgetReached = false;
+	search -> extensions = search -> reductions = 0;
+
+	/* The default budget is the nodes of a full tree as deep as the 
+	 * extensions may reach, so it is only a safety net, a tighter budget
+	 * cuts the best-first order inside the extended branches and loses 
+	 * more than it saves (--node-budget sets a real one)
+	 */
+	search -> budget = search -> selective.nodeBudget;
+	if (search -> selective.enabled && search -> budget <= 0) {
+		long nodes = 1, level = 1;
+		int depth;
+		for (depth = 0; depth < max_depth + SELECTIVE_EXTENSIONS && 
+			nodes < INT_MAX; depth ++) {
+			level *= NUMBER_OF_MOVES;
+			nodes += level;
+		}
+		search -> budget = nodes < INT_MAX ? nodes : INT_MAX;
+	}
+
+	/* Under a budget the chunks of the arena stay small enough to be 
+	 * mapped without exceeding it, leaves are never allocated
+	 */
+	search -> nodes.maxChunk = search -> memoryLimit ? 
+		(size_t) fmax(search -> memoryLimit / ARENA_BUDGET_SHARE, PAGE) : 
+		ARENA_MAX_CHUNK;
 
 	// Create the start node, the move for this node can be anything
-	node_t *start = createNewNode(INITIAL, INITIAL, INITIAL, left, board, NULL); 
+	node_t *start = createNewNode(&search -> nodes, INITIAL, INITIAL, INITIAL,
+		left, board, NULL); 
+	start -> horizon = max_depth;
+
+	search -> expanded ++;
+	search -> countExplored ++;
+	TRACE_BEGIN(rootPush);
+	generatePossibility(&search -> frontier, start, 
+		search -> selective.enabled ? dominatedMoves(start, &search -> weights)
+		: 0, 0);
+	TRACE_END(rootPush, "generatePossibility", TRACE_NO_ARG);
+}
 
-	// Explored array used to free every possible nodes
-	node_t **explored = createExplored(maximumNode);
-	int countExplored = 0; // number of element on explored
+/** Advance the search by at most maxExpansions expanded nodes
+ * @param search Started search
+ * @param maxExpansions Number of nodes expanded before returning
+ * @return bool True once the frontier is exhausted
+ */
+bool
+stepSearch(search_t *search, int maxExpansions) {
+	int max_depth = search -> max_depth;
+	int expansions = 0, depthLimit;
 
-	// Push first element to the heap, heap only contain first element
-	heap_push(&h, start);
+	// Extended paths can go that deep, the bound of the pruning covers them
+	int deepest = max_depth + (search -> selective.enabled ? 
+		SELECTIVE_EXTENSIONS : 0);
+	int scaleDepth = search -> selective.enabled ? max_depth : 0;
+	uint8_t reduced, skipped;
 
 	/* Iterate until heap is empty, when we finish all possibility  
 	 * or when it is game over
 	 */
-	while(h.count != 0) {
+	while (search -> frontier.count != 0 && expansions < maxExpansions) {
 
-		// Pop the heap and process to check possible decision out of current
-		node_t *current = heap_delete(&h);
+		// Pop the heap, the entry only holds the parent and the move
+		TRACE_BEGIN(pop);
+		frontier_t entry = heap_delete(&search -> frontier);
+		TRACE_END(pop, "heap_delete", TRACE_NO_ARG);
+
+		/* Under max propagation skip subtrees whose best possible leaf
+		 * can not beat the best first depth move found so far, the 
+		 * bound of the parent also bounds this child
+		 */
+		if (search -> propagation == max && canPrune(entry.parent, 
+			entry.reduced, scaleDepth, search -> decisionMove,
+			search -> indexDecide)) {
+			search -> pruned ++;
+			continue;
+		}
+
+		/* Once the budget is reached the tree stops widening, every 
+		 * remaining entry is evaluated as a leaf that is never allocated
+		 */
+		if (!search -> degraded && search -> memoryLimit && 
+			!fitsBudget(search)) {
+			search -> degraded = true;
+			search -> degradedAt = search -> expanded;
+		}
+
+		// The node budget of the selective search stops widening the same way
+		if (!search -> budgetReached && search -> selective.enabled &&
+			search -> expanded >= search -> budget) {
+			search -> budgetReached = true;
+		}
+		bool widening = !search -> degraded && !search -> budgetReached;
+		depthLimit = widening ? INT_MAX : entry.parent -> depth + NEXT_LEVEL;
+
+		// Build the child board, invalid move does not create any node
+		node_t leaf;
+		TRACE_BEGIN(child);
+		node_t *current = generateChild(search, &entry, &leaf, depthLimit);
+		TRACE_END(child, "generateChild", TRACE_NO_ARG);
+		if (current == NULL) {
+			continue;
+		}
 
 		// Change value of number of expanded nodes
-		(*numberOfExpandedNode) ++;
+		search -> expanded ++;
+		expansions ++;
+
+		/* Append new nodes to array with depth 1 
+		 * as it will be used in decision
+		 */
+		if (current -> depth == DECISION_DEPTH) {
+			search -> decisionMove[search -> indexDecide ++] = current;
+		}
+
+		// The parent then have this as child
+		entry.parent -> num_childs ++;
 
-		// Insert into explored
-		explored = insertIntoExplored(explored, current, &maximumNode, 
-			&countExplored);
+		// Propagate back score to first action
+		TRACE_BEGIN(propagate);
+		propagateScore(current, horizonValue(current, max_depth), 
+			search -> propagation);
+		TRACE_END(propagate, "propagateScore", TRACE_NO_ARG);
+
+		// Leaves live on the stack, nothing to free or expand
+		if (current == &leaf) {
+			continue;
+		}
+
+		// Allocated from the arena
+		search -> countExplored ++;
 
 		// Generate possibility graph until specified depth
-		if (current -> depth < max_depth) {
-			/* Generate every possibility of current node and store valid 
-			 * move in heap
+		if (current -> depth < current -> horizon && widening) {
+			reduced = search -> selective.enabled ? 
+				dominatedMoves(current, &search -> weights) : 0;
+
+			/* The bound only depends on the node, it is computed once for
+			 * all of its children and those that can not win are not pushed
 			 */
-			generatePossibility(&indexDecide, decisionMove, current, 
-				propagation, numberOfGeneratedNode);
+			skipped = 0;
+			if (search -> propagation == max) {
+				current -> bound = upperBound(current -> board, 
+					current -> priority, deepest - current -> depth, 
+					&search -> weights);
+				skipped = (canPrune(current, false, scaleDepth, 
+					search -> decisionMove, search -> indexDecide) ? 
+					~reduced : 0) | (canPrune(current, true, scaleDepth, 
+					search -> decisionMove, search -> indexDecide) ? 
+					reduced : 0);
+			}
+
+			// Store every possible move of current node in heap
+			TRACE_BEGIN(push);
+			search -> pruned += generatePossibility(&search -> frontier, 
+				current, reduced, skipped);
+			TRACE_END(push, "generatePossibility", TRACE_NO_ARG);
 		}
 	}
 
-	// Decide best action best on greatest score, if tie select randomly
-	best_action = bestAction(decisionMove, indexDecide);
+	search -> done = search -> frontier.count == 0;
+	return search -> done;
+}
 
-	// Free all memory on the explored
-	freeExplored(explored, countExplored);
-	
-	return best_action;
+/** Best root move found so far, final once stepSearch returned true
+ * @param search Started search (NULL behaves as a search with no legal move)
+ * @param values Value of every move so far, 0 if not found (can be NULL)
+ * @param legalMoves Bit i is set if move i was found legal (can be NULL)
+ * @return best_action Move that lead to highest score, left if none yet
+ */
+move_t
+currentBestMove(search_t *search, uint32_t values[NUMBER_OF_MOVES], 
+	uint8_t *legalMoves) {
+	int i, indexDecide = search != NULL ? search -> indexDecide : INITIAL;
+
+	if (values != NULL) {
+		memset(values, 0, sizeof(uint32_t) * NUMBER_OF_MOVES);
+	}
+	if (legalMoves != NULL) {
+		*legalMoves = 0;
+	}
+	if (indexDecide == INITIAL) {
+		return left;
+	}
+
+	// Values of the root moves for callers that want more than the move
+	for (i = 0; i < indexDecide; i ++) {
+		if (values != NULL) {
+			values[search -> decisionMove[i] -> move] = 
+				search -> decisionMove[i] -> priority;
+		}
+		if (legalMoves != NULL) {
+			*legalMoves |= 1 << search -> decisionMove[i] -> move;
+		}
+	}
+
+	return bestAction(search -> decisionMove, indexDecide);
+}
+
+/** Stop the search and free its nodes, the heap and the chunks of the 
+ * arena are kept for the next start
+ * @param search Started search, finished or not
+ */
+void
+finishSearch(search_t *search) {
+	if (search -> countExplored == INITIAL) {
+		return;
+	}
+
+	// Everything only grows during the search, so this is its peak
+	lastSearchMemory = searchBytes(search);
+	lastSearchDegraded = search -> degraded;
+	lastSearchExtensions = search -> extensions;
+	lastSearchReductions = search -> reductions;
+	lastSearchBudget = search -> budgetReached;
+
+	// Every node goes at once
+	TRACE_BEGIN(release);
+	resetArena(&search -> nodes);
+	TRACE_END(release, "resetArena", search -> countExplored);
+
+	emptyPQ(&search -> frontier);
+	search -> countExplored = 0;
+	search -> indexDecide = 0;
+	search -> done = true;
+}
+
+/** Bytes currently held by a search, chunks of the arena and heap
+ * @param search Started search
+ * @return bytes Memory counted against the budget
+ */
+size_t
+searchBytes(search_t *search) {
+	return search -> nodes.reserved + 
+		search -> frontier.size * sizeof(frontier_t);
+}
+
+/** Whether expanding one more node keeps the search within its budget,
+ * counting the worst case where the arena needs a new chunk and the heap
+ * doubles. Depth 1 nodes are allocated even after degrading, so they are
+ * reserved up front
+ * @param search Started search
+ * @return bool True if the next expansion fits in the budget
+ */
+bool
+fitsBudget(search_t *search) {
+	size_t node = (sizeof(node_t) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	size_t next = searchBytes(search) + arenaNextChunk(&search -> nodes, 
+		(NUMBER_OF_MOVES + NEXT_LEVEL - search -> indexDecide) * node);
+
+	if (search -> frontier.count + NUMBER_OF_MOVES > search -> frontier.size) {
+		next += search -> frontier.size * sizeof(frontier_t);
+	}
+
+	return next <= search -> memoryLimit;
+}
+
+/** Free a search, finishing it first if needed
+ * @param search Initialised search
+ */
+void
+freeSearch(search_t *search) {
+	finishSearch(search);
+	heap_free(&search -> frontier);
+	freeArena(&search -> nodes);
 }
 
 /***************************EXPLORED*FUNCTION*********************************/
@@ -158,6 +576,7 @@ freeExplored(node_t **explored, int nexplore) {
 }
 
 /** Create new node and store information
+ * @param arena Arena of the search, NULL to malloc the node
  * @param score Score for that particular state
  * @param depth Depth for that particular state
  * @param num_childs Always 0 as at first does not have child
@@ -167,10 +586,11 @@ freeExplored(node_t **explored, int nexplore) {
  * @return node Node which are successfully created
  */
 node_t 
-*createNewNode(uint32_t score, int depth, int num_childs, move_t move, 
-	uint8_t board[SIZE][SIZE], node_t *parent)  {
-	// Allocate memory for new node
-	node_t *new = (node_t *) malloc(sizeof(node_t));
+*createNewNode(arena_t *arena, uint32_t score, int depth, int num_childs, 
+	move_t move, uint8_t board[SIZE][SIZE], node_t *parent)  {
+	// Allocate memory for new node, the arena is freed all at once
+	node_t *new = arena != NULL ? (node_t *) arenaAlloc(arena, sizeof(node_t))
+		: (node_t *) malloc(sizeof(node_t));
 	assert(new != NULL);
 
 	// Assign information to nodes
@@ -178,16 +598,53 @@ node_t
 	new -> depth = depth;
 	new -> num_childs = num_childs;
 	new -> move = move;
+	new -> horizon = depth;
 	new -> parent = parent;
 
 	// Copy original state of board to the new node before moving
 	copyBoard( new -> board, board);
+	initLines(new);
 	
 	return new;
 }
 
 /**************************BOARD*FUNCTION************************************/
 
+/** Pack a board into 64 bits, exponent of cell i * SIZE + j in nibble 
+ * i * SIZE + j starting from the lowest bits (exponents above 15 are lost)
+ * @param board Board to be packed
+ * @return packed Packed board
+ */
+uint64_t
+packBoard(uint8_t board[SIZE][SIZE]) {
+	uint64_t packed = 0;
+	int i, j;
+
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j++) {
+			packed |= (uint64_t) (board[i][j] & NIBBLE) << 
+				(NIBBLE_BITS * (i * SIZE + j));
+		}
+	}
+
+	return packed;
+}
+
+/** Unpack a board packed by packBoard
+ * @param packed Packed board
+ * @param board Unpacked board
+ */
+void
+unpackBoard(uint64_t packed, uint8_t board[SIZE][SIZE]) {
+	int i, j;
+
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j++) {
+			board[i][j] = (packed >> (NIBBLE_BITS * (i * SIZE + j))) & NIBBLE;
+		}
+	}
+}
+
 /** Compare between board, return true if board is the same, false
  *  otherwise
  * @param board1 Board to be compared
@@ -247,6 +704,236 @@ maximumTile(uint8_t board[SIZE][SIZE]) {
 	return max;
 }
 
+/** Hash the board, used as seed for random tile inside the search
+ * @param board Board to be hashed
+ * @return hash FNV-1a hash of every tiles
+ */
+uint32_t
+hashBoard(uint8_t board[SIZE][SIZE]) {
+	uint32_t hash = 2166136261u;
+	int i, j;
+
+	// Mix every elements
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j++) {
+			hash = (hash ^ board[i][j]) * 16777619u;
+		}
+	}
+
+	return hash;
+}
+
+/*****************************LINE*FUNCTION**********************************/
+
+/** Whether the tiles of a row or column never increase or never decrease
+ * @param board Board holding the line
+ * @param k Index of the row or column
+ * @param column True for column k, row k otherwise
+ * @return bool True if the line is monotonic
+ */
+static bool
+isMonotonicLine(uint8_t board[SIZE][SIZE], int k, bool column) {
+	bool increasing = true, decreasing = true;
+	int p;
+
+	for (p = NEXT_LEVEL; p < SIZE; p ++) {
+		uint8_t previous = column ? board[p - 1][k] : board[k][p - 1];
+		uint8_t current = column ? board[p][k] : board[k][p];
+		increasing &= previous <= current;
+		decreasing &= previous >= current;
+	}
+
+	return increasing || decreasing;
+}
+
+/** Recompute the monotonic bits of the given rows and columns only
+ * @param node Node whose board is up to date
+ * @param rows Bit i set if row i has changed
+ * @param columns Bit j set if column j has changed
+ */
+static void
+updateMonotonic(node_t *node, int rows, int columns) {
+	int k;
+
+	for (k = 0; k < SIZE; k ++) {
+		if (rows >> k & 1) {
+			node -> monotonic = (node -> monotonic & ~(1 << k)) | 
+				isMonotonicLine(node -> board, k, false) << k;
+		}
+		if (columns >> k & 1) {
+			node -> monotonic = (node -> monotonic & ~(1 << (SIZE + k))) | 
+				isMonotonicLine(node -> board, k, true) << (SIZE + k);
+		}
+	}
+}
+
+/** Compute the terms of every row and column of the node from scratch, 
+ * children then update them incrementally
+ * @param node Node whose board is set
+ */
+void
+initLines(node_t *node) {
+	int i, j;
+
+	memset(node -> rowEmpty, 0, sizeof(node -> rowEmpty));
+	memset(node -> columnEmpty, 0, sizeof(node -> columnEmpty));
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j ++) {
+			if (node -> board[i][j] == 0) {
+				node -> rowEmpty[i] ++;
+				node -> columnEmpty[j] ++;
+			}
+		}
+	}
+
+	node -> monotonic = 0;
+	updateMonotonic(node, (1 << SIZE) - 1, (1 << SIZE) - 1);
+}
+
+/** Number of empty cells of the node, from its row terms
+ * @param node Node with up to date line terms
+ * @return count Empty cells
+ */
+uint8_t
+countEmptyLines(node_t *node) {
+	uint8_t count = 0;
+	int i;
+
+	for (i = 0; i < SIZE; i ++) {
+		count += node -> rowEmpty[i];
+	}
+
+	return count;
+}
+
+/** Number of monotonic rows and columns of the node
+ * @param node Node with up to date line terms
+ * @return count Monotonic lines
+ */
+uint8_t
+countMonotonicLines(node_t *node) {
+	return __builtin_popcount(node -> monotonic);
+}
+
+/** Apply the move to the board of node and write the result to child one
+ * line at a time, same rules as execute_move_t. Node is left as it is, the
+ * empty cells of child are counted while its lines are written and the 
+ * monotonic terms are only updated for lines that changed (not kept at all
+ * with a zero weight). Only the board and line terms of child are written
+ * @param node Node whose board is moved
+ * @param child Node receiving the moved board and its line terms
+ * @param move Move to be applied
+ * @param score Score increased by every merge
+ * @param weights Weights of the evaluation terms
+ * @return bool True if the board has changed
+ */
+bool
+moveLines(node_t *node, node_t *child, move_t move, uint32_t *score, 
+	weights_t *weights) {
+	// Left and right slide the columns, up and down slide the rows
+	bool columns = move == left || move == right;
+	bool reversed = move == right || move == down;
+	uint8_t line[SIZE];
+	int lines = 0, crossed = 0; // lines moved, lines across with a change
+	int k, p, i, j;
+
+	memset(child -> rowEmpty, 0, sizeof(child -> rowEmpty));
+	memset(child -> columnEmpty, 0, sizeof(child -> columnEmpty));
+
+	for (k = 0; k < SIZE; k ++) {
+		// Read the line starting from the cell the tiles slide towards
+		for (p = 0; p < SIZE; p ++) {
+			i = columns ? (reversed ? SIZE - 1 - p : p) : k;
+			j = columns ? k : (reversed ? SIZE - 1 - p : p);
+			line[p] = node -> board[i][j];
+		}
+
+		if (slideArray(line, score)) {
+			lines |= 1 << k;
+		}
+
+		// Write the line, the board of node still holds the cells before
+		for (p = 0; p < SIZE; p ++) {
+			i = columns ? (reversed ? SIZE - 1 - p : p) : k;
+			j = columns ? k : (reversed ? SIZE - 1 - p : p);
+			child -> rowEmpty[i] += line[p] == 0;
+			child -> columnEmpty[j] += line[p] == 0;
+			crossed |= (node -> board[i][j] != line[p]) << (columns ? i : j);
+			child -> board[i][j] = line[p];
+		}
+	}
+
+	child -> monotonic = node -> monotonic;
+	if (weights -> weight[WEIGHT_MONOTONIC] == 0) {
+		return lines != 0;
+	}
+	if (columns) {
+		updateMonotonic(child, crossed, lines);
+	}
+	else {
+		updateMonotonic(child, lines, crossed);
+	}
+
+	return lines != 0;
+}
+
+/** Every legal successor of a node in one pass, the mask comes from 
+ * legalMoves so illegal moves are never slid. Successors are not spawned
+ * @param node Node whose board is moved
+ * @param child Board and line terms of the successor of every legal move
+ * @param gains Merge score of every legal move
+ * @param weights Weights of the evaluation terms
+ * @return mask Bit m set if move m is legal, 0 if the game has ended
+ */
+uint8_t
+successorNodes(node_t *node, node_t child[NUMBER_OF_MOVES], 
+	uint32_t gains[NUMBER_OF_MOVES], weights_t *weights) {
+	uint8_t mask = legalMoves(node -> board);
+	int move;
+
+	for (move = left; move <= down; move ++) {
+		if (mask >> move & 1) {
+			gains[move] = 0;
+			moveLines(node, &child[move], move, &gains[move], weights);
+		}
+	}
+
+	return mask;
+}
+
+/** Counterpart of addRandomSeeded on a node, same draws from the same 
+ * state, the rows before the chosen cell are skipped with their terms
+ * @param node Node receiving the new tile
+ * @param state Random state (xorshift)
+ * @param weights Weights of the evaluation terms
+ */
+void
+spawnLines(node_t *node, uint32_t *state, weights_t *weights) {
+	uint8_t len = countEmptyLines(node), r;
+	int i = 0, j = 0;
+
+	if (*state == 0) {
+		*state = 1;
+	}
+	if (len == 0) {
+		return;
+	}
+
+	// Index of the chosen cell among the empty cells in row order
+	r = nextRandom(state) % len;
+	while (r >= node -> rowEmpty[i]) {
+		r -= node -> rowEmpty[i ++];
+	}
+	for (j = 0; node -> board[i][j] != 0 || r -- != 0; j ++);
+
+	node -> board[i][j] = (nextRandom(state) % 10) / 9 + 1;
+	node -> rowEmpty[i] --;
+	node -> columnEmpty[j] --;
+	if (weights -> weight[WEIGHT_MONOTONIC] != 0) {
+		updateMonotonic(node, 1 << i, 1 << j);
+	}
+}
+
 /*******************************HELPER*FUNCTION******************************/
 
 /** Decide the best move depending on final data of expansion 
@@ -269,81 +956,106 @@ bestAction(node_t *decisionMove[], int indexDecide) {
 	return decisionMove[bestIndex] -> move;
 }
 
-/** Generate possible expansion for a current condition and store
- * possible movement to the heap
- * @param indexDecide Index that keep track for first depth node
- * @param decisionMove Array that save first depth movement
- * @param current Current node that are directly pop from heap
- * @param propagation Type of propagation
- * @param numberOfGeneratedNode number of nodes after applying action
+/** Store every legal movement of current node to the heap, the child 
+ * boards are not built until the entries are popped
+ * @param frontier Heap of the search
+ * @param current Node that will be expanded
+ * @param reduced Bit m set if move m is searched one level shallower
+ * @param skipped Bit m set if move m is pruned and never pushed
+ * @return int Number of legal moves that were skipped
  */
-void
-generatePossibility(int *indexDecide, node_t *decisionMove[], node_t *current,
-	propagation_t propagation, int *numberOfGeneratedNode) {
+int
+generatePossibility(struct heap *frontier, node_t *current, 
+	uint8_t reduced, uint8_t skipped) {
 	// Possible movement decision choice
 	move_t moves[NUMBER_OF_MOVES] = {left, right, up, down};
+	uint8_t mask = legalMoves(current -> board);
+	frontier_t entry;
 	int i;
 
-	uint8_t newBoard[SIZE][SIZE]; // newly generated board for copying
+	/* Child priority is never lower than parent priority, so the parent
+	 * priority is used to order the entries
+	 */
+	entry.priority = current -> priority;
+	entry.parent = current;
+
+	// Illegal and pruned moves never reach the heap
+	for (i = 0; i < NUMBER_OF_MOVES; i ++) {
+		if ((mask & ~skipped) >> moves[i] & 1) {
+			entry.move = moves[i];
+			entry.reduced = reduced >> moves[i] & 1;
+			heap_push(frontier, entry);
+		}
+	}
+
+	return __builtin_popcount(mask & skipped);
+}
 
+/** Build the node described by a frontier entry
+ * @param search Search of the entry, allocated children come from its arena
+ * @param entry Popped entry holding parent and move
+ * @param leaf Storage used for node at their horizon, which are never 
+ * expanded
+ * @param depthLimit Depth from which children are leaves whatever their 
+ * horizon
+ * @return node New node, leaf or NULL if the move does not change the board
+ */
+node_t
+*generateChild(search_t *search, frontier_t *entry, node_t *leaf, 
+	int depthLimit) {
+	weights_t *weights = &search -> weights;
+	node_t *parent = entry -> parent;
 	bool success; // used to store validity of movement
 
-	/* Set the score to previous state of board, since node current
-	 * with depth 1 might change as when invoking propagation
+	/* Set the score to previous state of board, taken from the entry since
+	 * depth 1 parent might have been changed by propagation since the push
 	 */
-	uint32_t parentScore = current -> priority;
-	uint32_t score = 0; // keep track of the score for each movement
-	
-	// Generate every possible decision from current node (only 1 movement)
-	for (i = 0; i < NUMBER_OF_MOVES; i ++) {
-		// Set the board and score for current condition before move
-		score = parentScore;
-		copyBoard(newBoard, current -> board);
+	uint32_t score = entry -> priority, gain = 0;
 
-		// Update the board condition for this movement
-		success = execute_move_t(newBoard, &score, moves[i]);
+	// The board and line terms of the child are written from the parent
+	success = moveLines(parent, leaf, entry -> move, &gain, weights);
 
-		// Add new random on board if movement is valid
-		if (success) {
-			addRandom(newBoard);
-		}
+	// Change value of number of generated nodes after applying action
+	search -> generated ++;
 
-		/* Change value of number of generated nodes after applying action,
-		 * but creation of new nodes is after validity checking for
-		 * the purpose of copying node data just once
-		 */
-		(*numberOfGeneratedNode) ++;
+	// Not valid (death or stucked), nothing is created
+	if (!success) {
+		return NULL;
+	}
 
-		/* Process the new board if the new nodes movement
-		 * is valid (not death or stucked)
-		 */
-		if (!isEqualBoard(newBoard, current -> board)) {
-			/* Create new node with certain movement,
- 			 * here we give bonus depending on the number of empty
- 			 * space on the board as less element in board
- 			 * gives better positioning
- 			 */
-			node_t *new = createNewNode(score + countEmpty(newBoard),
-			 current -> depth + NEXT_LEVEL, INITIAL, moves[i], 
-			 newBoard, current);
-
-			/* Append new nodes to array with depth 1 
-			 * as it will be used in decision
-			 */
-			if (new -> depth == DECISION_DEPTH) {
-				decisionMove[(*indexDecide) ++] = new;
-			}
+	/* Add new random on board, the tile is derived from the board so that
+	 * the tree does not depend on the order of expansion (required by 
+	 * pruning)
+	 */
+	uint32_t seed = hashBoard(leaf -> board);
+	spawnLines(leaf, &seed, weights);
 
-			// Insert to heap for later process (possible move from new)
-			heap_push(&h, new);
+	/* Here we give bonus depending on the number of empty space on the 
+	 * board as less element in board gives better positioning, and on the
+	 * lines whose tiles are ordered
+	 */
+	score += weights -> weight[WEIGHT_SCORE] * gain + 
+		weights -> weight[WEIGHT_EMPTY] * countEmptyLines(leaf) + 
+		weights -> weight[WEIGHT_MONOTONIC] * countMonotonicLines(leaf);
+
+	leaf -> priority = score;
+	leaf -> depth = parent -> depth + NEXT_LEVEL;
+	leaf -> num_childs = INITIAL;
+	leaf -> move = entry -> move;
+	leaf -> parent = parent;
+	selectHorizon(search, entry, leaf);
+
+	// Depth 1 nodes are kept for the decision, so they are always allocated
+	if ((leaf -> depth >= leaf -> horizon || leaf -> depth >= depthLimit) && 
+		leaf -> depth != DECISION_DEPTH) {
+		return leaf;
+	}
 
-			// The parent then have this as child
-			current -> num_childs ++;
+	node_t *new = (node_t *) arenaAlloc(&search -> nodes, sizeof(node_t));
+	assert(new != NULL);
+	*new = *leaf;
 
-			// Propagate back score to first action
-			propagateScore(new, propagation);
-		}
-	}
+	return new;
 }
 
 /** Get the maximum value of an array 
@@ -376,29 +1088,36 @@ int
 getBestRandomIndex(node_t *decisionMove[], int n, uint32_t max) {
 	int randomIndex[NUMBER_OF_MOVES];
 	int nIndex = 0;
-	int i;
+	int i, move;
 
-	// Initialize seed
-	srand(time(NULL));
-
-	// Check for the index of tie element
-	for (i = 0; i < n; i ++) {
-		// Store every index of that tie maximum
-		if (decisionMove[i] -> priority == max) {
-			randomIndex[nIndex ++] = i;
+	/* rand() is seeded once per game (addRandom), reseeding here would
+	 * repeat the same tie break within a second and break seeded runs,
+	 * seeded games give their own stream with setTieBreak
+	 */
+	/* Check for the index of tie element, in move order rather than in the
+	 * order of expansion so that the kernels break ties the same way
+	 */
+	for (move = left; move <= down; move ++) {
+		for (i = 0; i < n; i ++) {
+			// Store every index of that tie maximum
+			if (decisionMove[i] -> move == move && 
+				decisionMove[i] -> priority == max) {
+				randomIndex[nIndex ++] = i;
+			}
 		}
 	}
 
 	// Get the random index
-	return randomIndex[rand() % nIndex]; 
+	return randomIndex[tieBreak(nIndex)]; 
 }
 
 /** Used to propagate score back to the first depth node 
  * @param node Current child node
+ * @param value Value of the node, its priority seen at max_depth
  * @param propagation Type of propagation
  */
 void 
-propagateScore(node_t* node, propagation_t propagation) {
+propagateScore(node_t* node, uint32_t value, propagation_t propagation) {
 	// Nothing to propagate as we are at first depth
 	if (node -> depth == DECISION_DEPTH) {
 		return;
@@ -423,8 +1142,8 @@ propagateScore(node_t* node, propagation_t propagation) {
 		/* Now we have both the new node and the decision parent node,
 		 * thus change the priority of parent if the child is greater 
 		 */
-		if (node -> priority > parent -> priority) {
-			parent -> priority = node -> priority;
+		if (value > parent -> priority) {
+			parent -> priority = value;
 		}
 	}
 
@@ -432,12 +1151,12 @@ propagateScore(node_t* node, propagation_t propagation) {
 	else {
 		// First insertion of average, just change that first depth priority
 		if (parent -> num_childs == CHILD_INSERTION) {
-			parent -> priority = node -> priority;
+			parent -> priority = value;
 		}
 		// Get new average
 		else {
 			parent -> priority = (parent -> priority * 
-				(parent -> num_childs - CHILD_INSERTION) + node -> priority) / 
+				(parent -> num_childs - CHILD_INSERTION) + value) / 
 			(parent -> num_childs);
 		}
 	}
@@ -445,3 +1164,184 @@ propagateScore(node_t* node, propagation_t propagation) {
 }
 
 
+
+/*****************************BRANCH*AND*BOUND*******************************/
+
+/** Admissible upper bound of any priority in the subtree of a board. 
+ * Priority grows by the weighted terms on every level, the merge score is 
+ * bounded by merging every equal pair of tiles at once (ignoring adjacency)
+ * and spawning both a 2 and a 4 after each move, the other terms by their
+ * largest value
+ * @param board Board whose subtree is bounded
+ * @param priority Priority of the board itself
+ * @param remainingDepth Number of levels below board
+ * @param weights Weights of the evaluation terms
+ * @return bound Highest priority reachable below board
+ */
+uint32_t
+upperBound(uint8_t board[SIZE][SIZE], uint32_t priority, int remainingDepth,
+	weights_t *weights) {
+	int count[MAX_EXPONENT + NEXT_LEVEL] = {0};
+	uint64_t bound = priority;
+	uint64_t gain;
+	int carry, next, top = SPAWN_HIGH; // no tile above top
+	int i, j, level;
+
+	// Histogram of tiles exponent
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j++) {
+			if (board[i][j] != 0) {
+				count[board[i][j]] ++;
+				top = board[i][j] > top ? board[i][j] : top;
+			}
+		}
+	}
+
+	for (level = 0; level < remainingDepth; level ++) {
+		// Merge every pair, merged tiles can not merge again in same move
+		gain = 0;
+		carry = 0;
+		for (i = 1; i <= top && i < MAX_EXPONENT; i ++) {
+			next = count[i] / BASE;
+			gain += (uint64_t) next << (i + NEXT_LEVEL);
+			count[i] = count[i] % BASE + carry;
+			carry = next;
+		}
+		count[i] += carry;
+		top = carry ? i : top;
+
+		// Spawn after the move and maximum bonus of the other terms
+		count[SPAWN_LOW] ++;
+		count[SPAWN_HIGH] ++;
+		bound += weights -> weight[WEIGHT_SCORE] * gain + 
+			weights -> weight[WEIGHT_EMPTY] * (SIZE * SIZE - NEXT_LEVEL) +
+			weights -> weight[WEIGHT_MONOTONIC] * (SIZE + SIZE);
+
+		if (bound >= UINT32_MAX) {
+			return UINT32_MAX;
+		}
+	}
+
+	return (uint32_t) bound;
+}
+
+/** Decide whether a child of parent can be skipped, it is pruned when even
+ * the upper bound of the parent subtree is lower than the best first depth
+ * move, ties are kept so that the random tie break sees the same candidates
+ * @param parent Expanded node, its bound is set
+ * @param reduced The child is searched one level shallower
+ * @param scaleDepth Depth horizonValue scales the leaves of a reduced 
+ * subtree up to, 0 if nothing is scaled up
+ * @param decisionMove Array that save first depth movement
+ * @param indexDecide Index that keep track for first depth node
+ * @return bool True if the subtree can not change the decision
+ */
+bool
+canPrune(node_t *parent, bool reduced, int scaleDepth, 
+	node_t *decisionMove[], int indexDecide) {
+	int shallowest = parent -> depth + NEXT_LEVEL;
+
+	// Children of root and empty decision can not be pruned
+	if (parent -> depth == INITIAL || indexDecide == INITIAL) {
+		return false;
+	}
+
+	uint64_t bound = parent -> bound;
+
+	/* A leaf of a reduced subtree is worth its priority scaled by 
+	 * scaleDepth over its depth, at most scaleDepth over the shallowest
+	 */
+	if ((reduced || parent -> horizon < scaleDepth) && 
+		shallowest < scaleDepth) {
+		bound = bound * scaleDepth / shallowest;
+	}
+
+	return bound < getMaximum(decisionMove, indexDecide);
+}
+
+/*****************************SELECTIVE*SEARCH*******************************/
+
+/** Moves that are clearly worse than a sibling, from the merges and empty 
+ * cells of every successor before its spawn
+ * @param node Node whose moves are compared
+ * @param weights Weights of the evaluation terms
+ * @return mask Bit m set if move m is worth SELECTIVE_MARGIN merged points 
+ * less than the best move
+ */
+uint8_t
+dominatedMoves(node_t *node, weights_t *weights) {
+	uint8_t next[NUMBER_OF_MOVES][SIZE][SIZE];
+	uint32_t gains[NUMBER_OF_MOVES], value[NUMBER_OF_MOVES], best = 0;
+	uint32_t margin = weights -> weight[WEIGHT_SCORE] * SELECTIVE_MARGIN;
+	uint8_t mask = successorBoards(node -> board, next, gains);
+	uint8_t dominated = 0;
+	int move;
+
+	for (move = left; move <= down; move ++) {
+		if (mask >> move & 1) {
+			value[move] = weights -> weight[WEIGHT_SCORE] * gains[move] + 
+				weights -> weight[WEIGHT_EMPTY] * countEmpty(next[move]);
+			if (value[move] > best) {
+				best = value[move];
+			}
+		}
+	}
+
+	for (move = left; move <= down; move ++) {
+		if (mask >> move & 1 && value[move] + margin < best) {
+			dominated |= 1 << move;
+		}
+	}
+
+	return dominated;
+}
+
+/** Horizon of a new node, the one of its parent unless the move was 
+ * dominated (one level less) or the node would be a leaf in a critical 
+ * position, almost full or with a single legal move (one level more, up to
+ * SELECTIVE_EXTENSIONS past max_depth)
+ * @param search Search of the node, counts the extensions and reductions
+ * @param entry Entry the node was built from
+ * @param child Node whose board and depth are set
+ */
+void
+selectHorizon(search_t *search, frontier_t *entry, node_t *child) {
+	child -> horizon = entry -> parent -> horizon;
+	if (!search -> selective.enabled) {
+		return;
+	}
+
+	if (entry -> reduced) {
+		if (child -> horizon > child -> depth) {
+			child -> horizon --;
+			search -> reductions ++;
+		}
+	}
+	else if (child -> depth >= child -> horizon && child -> horizon < 
+		search -> max_depth + SELECTIVE_EXTENSIONS && 
+		(countEmptyLines(child) <= SELECTIVE_EMPTY || 
+		__builtin_popcount(legalMoves(child -> board)) == NEXT_LEVEL)) {
+		child -> horizon ++;
+		search -> extensions ++;
+	}
+}
+
+/** Value of a node for the propagation, priorities add up on every level
+ * so nodes past max_depth and leaves of reduced branches above it are 
+ * scaled to max_depth, otherwise the extended branches would be preferred
+ * just for being deeper and the reduced ones pruned for being shallower
+ * @param node Node to be propagated
+ * @param max_depth Maximum depth of the search without extensions
+ * @return value Priority of the node, scaled unless it is at max_depth or
+ * an inner node above it
+ */
+uint32_t
+horizonValue(node_t *node, int max_depth) {
+	if (node -> depth == max_depth || (node -> depth < max_depth && 
+		node -> depth < node -> horizon)) {
+		return node -> priority;
+	}
+
+	uint64_t value = (uint64_t) node -> priority * max_depth / node -> depth;
+	return value < UINT32_MAX ? value : UINT32_MAX;
+}
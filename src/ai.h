@@ -14,15 +14,73 @@
 #include <unistd.h>
 #include "node.h"
 #include "priority_queue.h"
+#include "memory.h"
+#include "weights.h"
 
 /*****************************CONSTANT***************************************/
 
-#define NUMBER_OF_MOVES 4 // number of possible moves
 #define INITIAL 0
 #define NEXT_LEVEL 1
 #define REALLOC_FACTOR 2
 #define DECISION_DEPTH 1 // Depth for which we store all of the updated value
 #define CHILD_INSERTION 1 
+#define MAX_EXPONENT 32 // tile exponents are stored in uint8_t, 2^31 is plenty
+#define SPAWN_LOW 1 // exponent of the 2 tile spawned after each move
+#define SPAWN_HIGH 2 // exponent of the 4 tile spawned after each move
+#define NIBBLE 0xf
+#define NIBBLE_BITS 4
+
+/**
+ * Selective search, a node with at most SELECTIVE_EMPTY empty cells or a
+ * single legal move is searched one level deeper (at most 
+ * SELECTIVE_EXTENSIONS levels on a path), a move whose merges and empty 
+ * cells are worth SELECTIVE_MARGIN merged points less than its best 
+ * sibling is searched one level shallower
+ */
+#define SELECTIVE_EMPTY 2
+#define SELECTIVE_EXTENSIONS 2
+#define SELECTIVE_MARGIN 16
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Extensions and reductions of the searches of a thread, the node budget 
+ * bounds the extra nodes, once reached the search stops widening as when it
+ * runs out of memory
+ */
+typedef struct selective_s {
+	bool enabled;
+	int nodeBudget; // expanded nodes, 0 for the nodes of a full tree
+} selective_t;
+
+/**
+ * Resumable search, started on a board and advanced a bounded number of 
+ * expansions at a time, the frontier and counters are kept between steps.
+ * The heap and the arena are kept by finishSearch so the next search reuses
+ * their capacity, already faulted in on the node of the thread
+ */
+typedef struct search_s {
+	struct heap frontier;
+	arena_t nodes; // every allocated node, reset by finishSearch
+	int countExplored; // nodes allocated from the arena
+	node_t *decisionMove[NUMBER_OF_MOVES]; // depth 1 nodes
+	int indexDecide;
+	int max_depth;
+	propagation_t propagation;
+	int generated;
+	int expanded;
+	int pruned;
+	bool done; // frontier exhausted, the best move is final
+	size_t memoryLimit; // bytes of nodes, explored and heap, 0 unlimited
+	bool degraded; // budget reached, the tree stopped widening
+	int degradedAt; // expanded nodes when the search degraded
+	weights_t weights; // weights of the evaluation terms
+	selective_t selective;
+	int budget; // expanded nodes before the search stops widening
+	bool budgetReached;
+	int extensions; // nodes searched one level deeper
+	int reductions; // nodes searched one level shallower
+} search_t;
 
 /****************************FUNCTION-DECLARATION****************************/
 
@@ -32,27 +90,76 @@ void freeAI();
 move_t 
 get_next_move( uint8_t board[SIZE][SIZE], int max_depth, 
 	propagation_t propagation, int *numberOfGeneratedNode,
-	int *numberOfExpandedNode );
+	int *numberOfExpandedNode, int *numberOfPrunedNode );
+move_t searchMove(uint8_t board[SIZE][SIZE], int max_depth, 
+	propagation_t propagation, uint32_t values[NUMBER_OF_MOVES], 
+	uint8_t *legalMoves, int *numberOfGeneratedNode, 
+	int *numberOfExpandedNode, int *numberOfPrunedNode);
+size_t searchMemory();
+void recordSearch(size_t bytes);
+void searchPlacement(placement_t *placement);
+bool searchDegraded();
+void setMemoryLimit(size_t bytes);
+void setWeights(weights_t *weights);
+void setSelective(selective_t *selective);
+void setTieBreak(uint32_t seed);
+int tieBreak(int n);
+void searchSelectivity(int *extensions, int *reductions, bool *budgetReached);
+weights_t *searchWeights();
+
+/** Step-wise search */
+void initSearch(search_t *search);
+void startSearch(search_t *search, uint8_t board[SIZE][SIZE], int max_depth,
+	propagation_t propagation);
+bool stepSearch(search_t *search, int maxExpansions);
+move_t currentBestMove(search_t *search, uint32_t values[NUMBER_OF_MOVES], 
+	uint8_t *legalMoves);
+void finishSearch(search_t *search);
+void freeSearch(search_t *search);
+size_t searchBytes(search_t *search);
+bool fitsBudget(search_t *search);
 
 /** Array used for nodes memory purposes */
 node_t **createExplored(int size);
 node_t **insertIntoExplored(node_t **explored, node_t *node, int *size, 
 	int *countExplored);
 void freeExplored(node_t **explore, int nexplore);
-node_t *createNewNode(uint32_t score, int depth, int num_childs, move_t move, 
-	uint8_t board[SIZE][SIZE], node_t *parent);
+node_t *createNewNode(arena_t *arena, uint32_t score, int depth, 
+	int num_childs, move_t move, uint8_t board[SIZE][SIZE], node_t *parent);
 
 /** Board function */
 bool isEqualBoard(uint8_t board1[SIZE][SIZE], uint8_t board2[SIZE][SIZE]);
 void copyBoard(uint8_t duplicate[SIZE][SIZE], uint8_t original[SIZE][SIZE]);
 uint8_t maximumTile(uint8_t board[SIZE][SIZE]);
+uint32_t hashBoard(uint8_t board[SIZE][SIZE]);
+void initLines(node_t *node);
+uint8_t countEmptyLines(node_t *node);
+uint8_t countMonotonicLines(node_t *node);
+bool moveLines(node_t *node, node_t *child, move_t move, uint32_t *score, 
+	weights_t *weights);
+uint8_t successorNodes(node_t *node, node_t child[NUMBER_OF_MOVES], 
+	uint32_t gains[NUMBER_OF_MOVES], weights_t *weights);
+void spawnLines(node_t *node, uint32_t *state, weights_t *weights);
+uint64_t packBoard(uint8_t board[SIZE][SIZE]);
+void unpackBoard(uint64_t packed, uint8_t board[SIZE][SIZE]);
 
 /** Helper function used for main AI function */
-void propagateScore(node_t* node, propagation_t propagation);
+void propagateScore(node_t* node, uint32_t value, propagation_t propagation);
 uint32_t getMaximum(node_t *array[], int n);
 int getBestRandomIndex(node_t *decisionMove[], int n, uint32_t max);
-void generatePossibility(int *indexDecide, node_t *decisionMove[], 
-	node_t *current, propagation_t propagation, int *numberOfGeneratedNode);
+int generatePossibility(struct heap *frontier, node_t *current, 
+	uint8_t reduced, uint8_t skipped);
+node_t *generateChild(search_t *search, frontier_t *entry, node_t *leaf, 
+	int depthLimit);
+uint8_t dominatedMoves(node_t *node, weights_t *weights);
+void selectHorizon(search_t *search, frontier_t *entry, node_t *child);
+uint32_t horizonValue(node_t *node, int max_depth);
 move_t bestAction(node_t *decisionMove[], int indexDecide);
 
+/** Branch and bound used for max propagation */
+uint32_t upperBound(uint8_t board[SIZE][SIZE], uint32_t priority, 
+	int remainingDepth, weights_t *weights);
+bool canPrune(node_t *parent, bool reduced, int scaleDepth, 
+	node_t *decisionMove[], int indexDecide);
+
 #endif
@@ -0,0 +1,351 @@
+/*
+ ============================================================================
+ Name        : analyze.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Streaming offline analysis of positions over a worker pool
+ ============================================================================
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "analyze.h"
+#include "ai.h"
+#include "pool.h"
+#include "corpus.h"
+#include "metrics.h"
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * One position of the chunk, filled by the reader and the workers
+ */
+typedef struct position_s {
+	uint8_t board[SIZE][SIZE];
+	int depth;
+	propagation_t propagation;
+	move_t move;
+	uint8_t legal;
+	uint32_t values[NUMBER_OF_MOVES];
+	int expanded;
+	bool degraded; // the search reached the memory limit
+} position_t;
+
+/**
+ * Chunk shared with the worker pool, job i searches position i
+ */
+typedef struct batch_s {
+	position_t *positions;
+	int n;
+	size_t memoryLimit; // budget of every search, 0 unlimited
+} batch_t;
+
+/**
+ * Input being streamed, text through stdio or binary through mmap
+ */
+typedef struct input_s {
+	FILE *text;
+	const uint8_t *data;
+	size_t size;
+	size_t at;
+	int depth; // default depth
+	propagation_t propagation; // default propagation
+	long line;
+} input_t;
+
+/*****************************WORKER*FUNCTION********************************/
+
+/** Setup of every worker of the pool, each worker has its own heap under
+ * the memory limit of the analysis
+ * @param context Chunk shared with the reader
+ */
+static void
+analyzeSetup(void *context) {
+	setMemoryLimit(((batch_t *) context) -> memoryLimit);
+}
+
+/** Job of the pool, searches one position of the chunk, ties are broken
+ * from the board so the output does not depend on the threads
+ * @param context Chunk shared with the reader
+ * @param i Index of the position in the chunk
+ */
+static void
+analyzePosition(void *context, int i) {
+	position_t *position = &((batch_t *) context) -> positions[i];
+	int generated = 0, pruned = 0;
+
+	setTieBreak(hashBoard(position -> board) | 1);
+	position -> expanded = 0;
+	position -> move = searchMove(position -> board, position -> depth,
+		position -> propagation, position -> values, &position -> legal,
+		&generated, &position -> expanded, &pruned);
+	position -> degraded = searchDegraded();
+}
+
+/*****************************INPUT*FUNCTION*********************************/
+
+/** Check a depth of the input, the search needs at least one level and
+ * ANALYZE_MAX_DEPTH keeps a single position from running unbounded
+ * @param depth Depth to be checked
+ * @return bool True if it can be searched
+ */
+static bool
+validDepth(int depth) {
+	return depth >= 1 && depth <= ANALYZE_MAX_DEPTH;
+}
+
+/** Read the next text position, skipping comments and blank lines
+ * @param input Input being streamed
+ * @param position Position to be filled
+ * @return int 1 if read, 0 at the end, -1 on a bad line
+ */
+static int
+readText(input_t *input, position_t *position) {
+	char line[MAX_LINE], *token, *rest;
+	int depth;
+
+	while (fgets(line, MAX_LINE, input -> text) != NULL) {
+		input -> line ++;
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+		if (!parseBoard(line, position -> board)) {
+			return -1;
+		}
+
+		// Optional overrides, anything else (corpus stage) is ignored
+		position -> depth = input -> depth;
+		position -> propagation = input -> propagation;
+		for (token = strtok_r(line + SIZE * SIZE, " \t\n", &rest); 
+			token != NULL; token = strtok_r(NULL, " \t\n", &rest)) {
+			if (strcmp(token, "max") == 0) {
+				position -> propagation = max;
+			}
+			else if (strcmp(token, "avg") == 0) {
+				position -> propagation = avg;
+			}
+			else if (sscanf(token, "%d", &depth) == 1) {
+				position -> depth = depth;
+			}
+		}
+		return validDepth(position -> depth) ? 1 : -1;
+	}
+
+	return 0;
+}
+
+/** Read the next binary position from the mapped file
+ * @param input Input being streamed
+ * @param position Position to be filled
+ * @return int 1 if read, 0 at the end, -1 on a bad entry
+ */
+static int
+readBinary(input_t *input, position_t *position) {
+	uint64_t packed = 0;
+	int i;
+
+	if (input -> at + ANALYZE_ENTRY > input -> size) {
+		return 0;
+	}
+
+	const uint8_t *entry = input -> data + input -> at;
+	for (i = sizeof(uint64_t) - 1; i >= 0; i --) {
+		packed = packed << 8 | entry[i];
+	}
+	unpackBoard(packed, position -> board);
+
+	position -> depth = entry[8] ? entry[8] : input -> depth;
+	position -> propagation = entry[9] == ANALYZE_DEFAULT ? 
+		input -> propagation : entry[9] == avg ? avg : max;
+	input -> at += ANALYZE_ENTRY;
+	input -> line ++;
+	return validDepth(position -> depth) ? 1 : -1;
+}
+
+/** Open the input, binary if it starts with ANALYZE_MAGIC
+ * @param input Input to be opened, defaults already set
+ * @param path File to be read
+ * @return bool False if it can not be read
+ */
+static bool
+openInput(input_t *input, const char *path) {
+	struct stat info;
+
+	input -> text = NULL;
+	input -> data = NULL;
+	input -> line = 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &info) != 0) {
+		return false;
+	}
+
+	if (info.st_size >= ANALYZE_MAGIC_LENGTH) {
+		const uint8_t *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+			fd, 0);
+		if (data != MAP_FAILED && 
+			memcmp(data, ANALYZE_MAGIC, ANALYZE_MAGIC_LENGTH) == 0) {
+			madvise((void *) data, info.st_size, MADV_SEQUENTIAL);
+			input -> data = data;
+			input -> size = info.st_size;
+			input -> at = ANALYZE_MAGIC_LENGTH;
+			close(fd);
+			return true;
+		}
+		if (data != MAP_FAILED) {
+			munmap((void *) data, info.st_size);
+		}
+	}
+
+	input -> text = fdopen(fd, "r");
+	return input -> text != NULL;
+}
+
+/** Close the input
+ * @param input Input to be closed
+ */
+static void
+closeInput(input_t *input) {
+	if (input -> data != NULL) {
+		munmap((void *) input -> data, input -> size);
+	}
+	if (input -> text != NULL) {
+		fclose(input -> text);
+	}
+}
+
+/*****************************OUTPUT*FUNCTION********************************/
+
+/** Write the results of a chunk in input order
+ * @param fp Output file
+ * @param chunk Analyzed positions
+ * @param n Number of positions
+ */
+static void
+writeChunk(FILE *fp, position_t *chunk, int n) {
+	static const char moveName[NUMBER_OF_MOVES][6] = {
+		"left", "right", "up", "down"
+	};
+	char text[SIZE * SIZE + 1];
+	int i;
+
+	for (i = 0; i < n; i ++) {
+		position_t *position = &chunk[i];
+		formatBoard(position -> board, text);
+		fprintf(fp, "%s %s %d %s %x %u %u %u %u %d%s\n", text, 
+			position -> propagation == max ? "max" : "avg", position -> depth,
+			position -> legal ? moveName[position -> move] : "none", 
+			position -> legal, position -> values[left], 
+			position -> values[right], position -> values[up], 
+			position -> values[down], position -> expanded, 
+			position -> degraded ? " degraded" : "");
+	}
+}
+
+/*****************************ANALYZE*FUNCTION*******************************/
+
+/** ./2048 analyze <input> <output> [--depth n] [--mode max|avg] 
+ * [--threads n] [--mem-limit bytes], positions are read ANALYZE_CHUNK at a
+ * time, searched by the pool and written before the next chunk is read, so
+ * memory does not depend on the size of the input
+ * @param argc Number of arguments
+ * @param argv Arguments, argv[1] is analyze
+ * @return int Exit status
+ */
+int
+analyzePositions(int argc, char *argv[]) {
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	uint64_t total = 0, expanded = 0;
+	input_t input;
+	batch_t chunk;
+	pool_t pool;
+	int i, status = 1;
+
+	input.depth = ANALYZE_DEPTH;
+	input.propagation = max;
+	chunk.memoryLimit = 0;
+	for (i = 4; i < argc; i ++) {
+		if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &input.depth);
+		}
+		else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+			input.propagation = strcmp(argv[++ i], "avg") == 0 ? avg : max;
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &threads);
+		}
+		else if (strcmp(argv[i], "--mem-limit") == 0 && i + 1 < argc) {
+			chunk.memoryLimit = parseBytes(argv[++ i]);
+		}
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (!validDepth(input.depth)) {
+		fprintf(stderr, "--depth must be between 1 and %d\n", 
+			ANALYZE_MAX_DEPTH);
+		return EXIT_FAILURE;
+	}
+
+	if (!openInput(&input, argv[2])) {
+		fprintf(stderr, "can not read %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	FILE *fp = strcmp(argv[3], "-") == 0 ? stdout : fopen(argv[3], "w");
+	if (fp == NULL) {
+		fprintf(stderr, "can not write %s\n", argv[3]);
+		closeInput(&input);
+		return EXIT_FAILURE;
+	}
+
+	chunk.positions = (position_t *) malloc(sizeof(position_t) * 
+		ANALYZE_CHUNK);
+	assert(chunk.positions != NULL);
+	initPool(&pool, threads, analyzePosition, analyzeSetup, &chunk);
+
+	double start = wallClock();
+	while (status > 0) {
+		// Fill the chunk, the workers are waiting for the next batch
+		chunk.n = 0;
+		while (chunk.n < ANALYZE_CHUNK && (status = input.data != NULL ? 
+			readBinary(&input, &chunk.positions[chunk.n]) : 
+			readText(&input, &chunk.positions[chunk.n])) > 0) {
+			chunk.n ++;
+		}
+
+		if (chunk.n > 0) {
+			runPool(&pool, chunk.n);
+			writeChunk(fp, chunk.positions, chunk.n);
+
+			total += chunk.n;
+			for (i = 0; i < chunk.n; i ++) {
+				expanded += chunk.positions[i].expanded;
+			}
+		}
+	}
+	double end = wallClock();
+
+	freePool(&pool);
+
+	if (status < 0) {
+		fprintf(stderr, "bad position on line %ld of %s\n", input.line, 
+			argv[2]);
+	}
+	fprintf(stderr, "%llu positions, %d threads, %.3f s, %.1f positions/s, "
+		"%.0f nodes/s\n", (unsigned long long) total, threads, end - start, 
+		total / (end - start), expanded / (end - start));
+
+	if (fp != stdout) {
+		fclose(fp);
+	}
+	closeInput(&input);
+	free(chunk.positions);
+
+	return status < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+/*
+ ============================================================================
+ Name        : analyze.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Streaming offline analysis of positions over a worker pool
+ ============================================================================
+ */
+
+#ifndef __ANALYZE__
+#define __ANALYZE__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * Input is either text, one position per line as in the corpus files:
+ *     <SIZE * SIZE hex exponents> [max|avg] [depth]
+ * or binary, ANALYZE_MAGIC followed by ANALYZE_ENTRY bytes per position:
+ *     board(u64, packBoard) depth(u8, 0 default) propagation(u8, 0 max, 
+ *     1 avg, 0xff default) reserved(6 bytes)
+ * Output has one line per position, in input order:
+ *     <board> <max|avg> <depth> <move|none> <legal mask> <value of left 
+ *     right up down> <expanded> [degraded]
+ * where degraded marks searches that reached --mem-limit. A depth outside
+ * 1..ANALYZE_MAX_DEPTH is a bad position, like a bad board
+ */
+#define ANALYZE_MAGIC "2048POS1"
+#define ANALYZE_MAGIC_LENGTH 8
+#define ANALYZE_ENTRY 16
+#define ANALYZE_DEFAULT 0xff
+#define ANALYZE_CHUNK 4096 // positions in memory at once
+#define ANALYZE_DEPTH 4
+#define ANALYZE_MAX_DEPTH 10
+
+/****************************FUNCTION-DECLARATION****************************/
+
+int analyzePositions(int argc, char *argv[]);
+
+#endif
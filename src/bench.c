@@ -0,0 +1,837 @@
+/*
+ ============================================================================
+ Name        : bench.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Microbenchmark of the engine kernels on fixed seeds 
+               (make bench)
+ ============================================================================
+ */
+
+#include "ai.h"
+#include "utils.h"
+#include "metrics.h"
+#include "priority_queue.h"
+#include "corpus.h"
+#include "kernel.h"
+#include "lockstep.h"
+
+/*****************************CONSTANT***************************************/
+
+#define DEFAULT_REPETITIONS 10
+#define POSITIONS 64 // fixed positions every kernel runs on
+#define POSITION_SEED 2048u
+#define POSITION_STRIDE 7 // moves played between two sampled positions
+#define KERNEL_ROUNDS 20000 // passes over the positions for cheap kernels
+#define HEAP_OPERATIONS 1000000
+#define NODE_OPERATIONS 1000000
+#define SEARCH_POSITIONS 16 // positions searched per depth
+#define MIN_SEARCH_DEPTH 1
+#define MAX_SEARCH_DEPTH 7
+#define SELFPLAY_GAMES 512 // greedy games played per self-play repetition
+#define SELFPLAY_SEED 2048u
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+#define MAX_RESULTS 64
+#define MAX_NAME 32
+#define LATENCY_CORPUS "corpus/positions_v1.txt"
+#define LATENCY_DEPTH 4
+#define DEFAULT_THRESHOLD 10.0 // percent of slowdown tolerated by compare
+#define T_TABLE 30 // degrees of freedom in the critical t table
+#define T_NORMAL 1.645 // critical t above T_TABLE degrees of freedom
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Result of one benchmark over every repetition
+ */
+typedef struct result_s {
+	char name[MAX_NAME];
+	char unit[MAX_NAME];
+	double mean;
+	double stddev;
+	double min;
+	int repetitions;
+} result_t;
+
+/** Fixed positions, sampled from seeded random play */
+uint8_t positions[POSITIONS][SIZE][SIZE];
+
+/** Results in the order they are run, written to bench_results.csv */
+result_t results[MAX_RESULTS];
+int nResults = 0;
+
+/** One sided 95% critical t for 1 to T_TABLE degrees of freedom */
+static const double criticalT[T_TABLE] = {
+	6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860, 1.833, 1.812, 
+	1.796, 1.782, 1.771, 1.761, 1.753, 1.746, 1.740, 1.734, 1.729, 1.725, 
+	1.721, 1.717, 1.714, 1.711, 1.708, 1.706, 1.703, 1.701, 1.699, 1.697
+};
+
+/****************************POSITION*FUNCTION*******************************/
+
+/** Fill positions from random play with seeded spawns, restart the game 
+ * when it is over so early, mid and late game boards are all sampled
+ * @param seed Seed of moves and spawns
+ */
+void
+generatePositions(uint32_t seed) {
+	uint8_t board[SIZE][SIZE];
+	uint32_t score = 0;
+	int n = 0, step = 0;
+
+	memset(board, 0, sizeof(board));
+	addRandomSeeded(board, &seed);
+	addRandomSeeded(board, &seed);
+
+	while (n < POSITIONS) {
+		// Mostly left and up, like a corner strategy, to reach late game
+		move_t move = nextRandom(&seed) % (NUMBER_OF_MOVES + BASE);
+		if (move >= NUMBER_OF_MOVES) {
+			move = move == NUMBER_OF_MOVES ? left : up;
+		}
+
+		if (execute_move_t(board, &score, move)) {
+			addRandomSeeded(board, &seed);
+			if (++ step % POSITION_STRIDE == 0) {
+				copyBoard(positions[n ++], board);
+			}
+		}
+
+		if (gameEnded(board)) {
+			memset(board, 0, sizeof(board));
+			addRandomSeeded(board, &seed);
+			addRandomSeeded(board, &seed);
+		}
+	}
+}
+
+/****************************RESULT*FUNCTION*********************************/
+
+/** Summarize the samples of one benchmark and print it
+ * @param name Name of the benchmark
+ * @param unit Unit of the samples
+ * @param samples Value of every repetition
+ * @param repetitions Number of samples
+ */
+void
+report(const char *name, const char *unit, double samples[], 
+	int repetitions) {
+	result_t *result = &results[nResults ++];
+	double sum = 0, squares = 0;
+	int i;
+
+	assert(nResults <= MAX_RESULTS);
+	snprintf(result -> name, MAX_NAME, "%s", name);
+	snprintf(result -> unit, MAX_NAME, "%s", unit);
+	result -> min = samples[0];
+	result -> repetitions = repetitions;
+
+	for (i = 0; i < repetitions; i ++) {
+		sum += samples[i];
+		if (samples[i] < result -> min) {
+			result -> min = samples[i];
+		}
+	}
+	result -> mean = sum / repetitions;
+
+	// Sample standard deviation
+	for (i = 0; i < repetitions; i ++) {
+		squares += (samples[i] - result -> mean) * 
+			(samples[i] - result -> mean);
+	}
+	result -> stddev = repetitions > 1 ? sqrt(squares / (repetitions - 1)) 
+		: 0;
+
+	printf("%-24s %14.2f %-10s +- %5.1f%%  min %14.2f\n", name, 
+		result -> mean, unit, result -> mean > 0 ? 
+		PERCENT * result -> stddev / result -> mean : 0, result -> min);
+}
+
+/** Load results written by printResults
+ * @param path File to be read
+ * @param loaded Array of at least MAX_RESULTS results
+ * @return n Number of results, -1 if the file can not be read
+ */
+int
+loadResults(const char *path, result_t loaded[]) {
+	char line[MAX_LINE];
+	int n = 0;
+
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		return -1;
+	}
+
+	// Skip the header
+	if (fgets(line, MAX_LINE, fp) == NULL) {
+		fclose(fp);
+		return -1;
+	}
+
+	while (n < MAX_RESULTS && fgets(line, MAX_LINE, fp) != NULL) {
+		result_t *result = &loaded[n];
+		if (sscanf(line, "%31[^,],%31[^,],%lf,%lf,%lf,%d", result -> name, 
+			result -> unit, &result -> mean, &result -> stddev, 
+			&result -> min, &result -> repetitions) == 6) {
+			n ++;
+		}
+	}
+
+	fclose(fp);
+	return n;
+}
+
+/** Write every result to bench_results.csv
+ */
+void
+printResults() {
+	int i;
+
+	/** File open */
+	FILE *fp = fopen("bench_results.csv", "w");
+	assert(fp != NULL);
+
+	fprintf(fp, "name,unit,mean,stddev,min,repetitions\n");
+	for (i = 0; i < nResults; i ++) {
+		fprintf(fp, "%s,%s,%.4f,%.4f,%.4f,%d\n", results[i].name, 
+			results[i].unit, results[i].mean, results[i].stddev, 
+			results[i].min, results[i].repetitions);
+	}
+
+	fclose(fp);
+}
+
+/****************************KERNEL*BENCHMARK********************************/
+
+/** Time execute_move_t in one direction, including the board copy
+ * @param move Direction benchmarked
+ * @return ns Nanoseconds per move
+ */
+double
+benchMove(move_t move) {
+	uint8_t board[SIZE][SIZE];
+	uint32_t score = 0;
+	int round, i, changed = 0;
+
+	double start = wallClock();
+	for (round = 0; round < KERNEL_ROUNDS; round ++) {
+		for (i = 0; i < POSITIONS; i ++) {
+			copyBoard(board, positions[i]);
+			changed += execute_move_t(board, &score, move);
+		}
+	}
+	double end = wallClock();
+
+	// Keep the result alive so the loop is not removed
+	assert(changed >= 0);
+	return (end - start) * NANOSECOND / ((double) KERNEL_ROUNDS * POSITIONS);
+}
+
+/** Time copyBoard alone, the overhead inside benchMove and benchSpawn
+ * @return ns Nanoseconds per copy
+ */
+double
+benchCopy() {
+	uint8_t board[SIZE][SIZE];
+	int round, i, sum = 0;
+
+	double start = wallClock();
+	for (round = 0; round < KERNEL_ROUNDS; round ++) {
+		for (i = 0; i < POSITIONS; i ++) {
+			copyBoard(board, positions[i]);
+			sum += board[round % SIZE][i % SIZE];
+		}
+	}
+	double end = wallClock();
+
+	assert(sum >= 0);
+	return (end - start) * NANOSECOND / ((double) KERNEL_ROUNDS * POSITIONS);
+}
+
+/** Time gameEnded including the board copy, kept so the times compare with
+ * the older builds where gameEnded rotated the board in place
+ * @return ns Nanoseconds per call
+ */
+double
+benchGameEnded() {
+	uint8_t board[SIZE][SIZE];
+	int round, i, ended = 0;
+
+	double start = wallClock();
+	for (round = 0; round < KERNEL_ROUNDS; round ++) {
+		for (i = 0; i < POSITIONS; i ++) {
+			copyBoard(board, positions[i]);
+			ended += gameEnded(board);
+		}
+	}
+	double end = wallClock();
+
+	assert(ended >= 0);
+	return (end - start) * NANOSECOND / ((double) KERNEL_ROUNDS * POSITIONS);
+}
+
+/** Time addRandom including the board copy
+ * @return ns Nanoseconds per call
+ */
+double
+benchAddRandom() {
+	uint8_t board[SIZE][SIZE];
+	int round, i, sum = 0;
+
+	double start = wallClock();
+	for (round = 0; round < KERNEL_ROUNDS; round ++) {
+		for (i = 0; i < POSITIONS; i ++) {
+			copyBoard(board, positions[i]);
+			addRandom(board);
+			sum += board[0][0];
+		}
+	}
+	double end = wallClock();
+
+	assert(sum >= 0);
+	return (end - start) * NANOSECOND / ((double) KERNEL_ROUNDS * POSITIONS);
+}
+
+/** Time createNewNode from an arena then resetArena, the arena is kept
+ * between repetitions as the search keeps it between moves
+ * @return ns Nanoseconds per node
+ */
+double
+benchArenaNodes() {
+	static arena_t arena;
+	static bool ready = false;
+	int i;
+
+	if (!ready) {
+		initArena(&arena, ARENA_MAX_CHUNK);
+		ready = true;
+	}
+
+	double start = wallClock();
+	for (i = 0; i < NODE_OPERATIONS; i ++) {
+		createNewNode(&arena, i, i % MAX_SEARCH_DEPTH, INITIAL, 
+			i % NUMBER_OF_MOVES, positions[i % POSITIONS], NULL);
+	}
+	resetArena(&arena);
+	double end = wallClock();
+
+	return (end - start) * NANOSECOND / NODE_OPERATIONS;
+}
+
+/** Time SELFPLAY_GAMES greedy games, one at a time with execute_move_t or
+ * in lockstep on packed boards (same games, same moves)
+ * @param lanes Lanes of the lockstep engine, 0 for the scalar games
+ * @return ns Nanoseconds per move
+ */
+double
+benchSelfPlay(int lanes) {
+	lockstep_t lockstep;
+	game_t game;
+	uint64_t turns = 0;
+	int i;
+
+	double start = wallClock();
+	if (lanes == 0) {
+		for (i = 0; i < SELFPLAY_GAMES; i ++) {
+			playGreedy(SELFPLAY_SEED, i, &game);
+			turns += game.turns;
+		}
+	}
+	else {
+		initLockstep(&lockstep, lanes, SELFPLAY_GAMES, SELFPLAY_SEED);
+		runLockstep(&lockstep);
+		for (i = 0; i < SELFPLAY_GAMES; i ++) {
+			turns += lockstep.results[i].turns;
+		}
+		freeLockstep(&lockstep);
+	}
+	double end = wallClock();
+
+	return (end - start) * NANOSECOND / turns;
+}
+
+/** Time HEAP_OPERATIONS pushes followed by as many deletes on the AI heap
+ * @param seed Seed of the priorities
+ * @return ns Nanoseconds per operation (push or delete)
+ */
+double
+benchHeap(uint32_t seed) {
+	frontier_t entry;
+	static struct heap h; // kept between repetitions, as in the search
+	uint64_t sum = 0;
+	int i;
+
+	if (h.heaparr == NULL) {
+		heap_init(&h);
+	}
+	entry.move = left;
+	entry.reduced = false;
+	entry.parent = NULL;
+
+	double start = wallClock();
+	for (i = 0; i < HEAP_OPERATIONS; i ++) {
+		entry.priority = nextRandom(&seed) % HEAP_OPERATIONS;
+		heap_push(&h, entry);
+	}
+	for (i = 0; i < HEAP_OPERATIONS; i ++) {
+		sum += heap_delete(&h).priority;
+	}
+	double end = wallClock();
+
+	assert(sum > 0);
+	return (end - start) * NANOSECOND / (2.0 * HEAP_OPERATIONS);
+}
+
+/** Time createNewNode into an explored array then freeExplored
+ * @return ns Nanoseconds per node (create and free)
+ */
+double
+benchNodes() {
+	int size = SIZE, countExplored = 0;
+	int i;
+
+	double start = wallClock();
+	node_t **explored = createExplored(size);
+	for (i = 0; i < NODE_OPERATIONS; i ++) {
+		node_t *node = createNewNode(NULL, i, i % MAX_SEARCH_DEPTH, INITIAL, 
+			i % NUMBER_OF_MOVES, positions[i % POSITIONS], NULL);
+		explored = insertIntoExplored(explored, node, &size, &countExplored);
+	}
+	freeExplored(explored, countExplored);
+	double end = wallClock();
+
+	return (end - start) * NANOSECOND / NODE_OPERATIONS;
+}
+
+/** Time get_next_move, or the kernel of that depth, on the first 
+ * SEARCH_POSITIONS positions
+ * @param depth Maximum depth of the search
+ * @param kernel Kernel of that depth under max, NULL for the generic engine
+ * @param nodesPerSecond Expanded nodes per second of wall time
+ * @return us Microseconds per move
+ */
+double
+benchSearch(int depth, const kernel_t *kernel, double *nodesPerSecond) {
+	int generated = 0, expanded = 0, pruned = 0;
+	int i;
+
+	double start = wallClock();
+	for (i = 0; i < SEARCH_POSITIONS; i ++) {
+		kernelMove(kernel, positions[i], depth, max, &generated, &expanded, 
+			&pruned);
+	}
+	double end = wallClock();
+
+	*nodesPerSecond = expanded / (end - start);
+	return (end - start) * MICROSECOND / SEARCH_POSITIONS;
+}
+
+/*****************************CORPUS*BENCHMARK*******************************/
+
+/** Search every position of a corpus once, the tie break is seeded by the
+ * index of the position so the checksum of the chosen moves only changes
+ * when the search itself changes
+ * @param path Corpus file
+ * @param propagation Type of propagation
+ * @param depth Maximum depth of the search
+ * @param kernel Kernel of that search, NULL for the generic engine
+ * @param selective Extensions and reductions of the generic engine
+ * @return int Exit status
+ */
+int
+benchCorpus(const char *path, propagation_t propagation, int depth, 
+	const kernel_t *kernel, selective_t selective) {
+	int generated = 0, expanded = 0, pruned = 0;
+	int extensions, reductions;
+	bool budgetReached;
+	uint32_t checksum = FNV_OFFSET;
+	double total = 0;
+	metrics_t metrics;
+	corpus_t corpus;
+	int i;
+
+	initCorpus(&corpus);
+	if (!loadCorpus(&corpus, path)) {
+		fprintf(stderr, "can not read corpus %s\n", path);
+		freeCorpus(&corpus);
+		return EXIT_FAILURE;
+	}
+
+	setSelective(&selective);
+	initMetrics(&metrics);
+	for (i = 0; i < corpus.n; i ++) {
+		srand(i);
+		double start = wallClock();
+		move_t move = kernelMove(kernel, corpus.boards[i], depth, 
+			propagation, &generated, &expanded, &pruned);
+		double end = wallClock();
+
+		recordMove(&metrics, end - start, searchMemory(), 
+			searchDegraded());
+		searchSelectivity(&extensions, &reductions, &budgetReached);
+		recordSelectivity(&metrics, extensions, reductions, budgetReached);
+		total += end - start;
+		checksum = (checksum ^ move) * FNV_PRIME;
+	}
+
+	printf("corpus     %s (%d positions)\n", path, corpus.n);
+	printf("search     %s %d (%s)\n", propagation == max ? "max" : "avg", 
+		depth, kernel != NULL ? "kernel" : selective.enabled ? "selective" :
+		"generic");
+	printf("time       %.3f s\n", total);
+	printf("expanded   %d (%d pruned)\n", expanded, pruned);
+	printf("nodes/s    %.0f\n", expanded / total);
+	if (selective.enabled) {
+		printf("selective  %ld extensions, %ld reductions, %d searches at "
+			"the node budget\n", metrics.extensions, metrics.reductions, 
+			metrics.budgetMoves);
+	}
+	printf("latency    p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+		latencyPercentile(&metrics, 50) * MICROSECOND, 
+		latencyPercentile(&metrics, 90) * MICROSECOND, 
+		latencyPercentile(&metrics, 99) * MICROSECOND, 
+		latencyPercentile(&metrics, PERCENT) * MICROSECOND);
+	printf("checksum   %08x\n", checksum);
+
+	freeMetrics(&metrics);
+	freeCorpus(&corpus);
+	return EXIT_SUCCESS;
+}
+
+/** Write a new corpus from seeded self play
+ * @param path Corpus file to be written
+ * @return int Exit status
+ */
+int
+makeCorpus(const char *path) {
+	corpus_t corpus;
+
+	initCorpus(&corpus);
+	generateCorpus(&corpus, CORPUS_PER_STAGE, CORPUS_SEED);
+	saveCorpus(&corpus, path);
+	printf("%d positions written to %s\n", corpus.n, path);
+	freeCorpus(&corpus);
+
+	return EXIT_SUCCESS;
+}
+
+/** Print how to run the benchmark
+ */
+void
+printBenchUsage() {
+	printf("USAGE: ./2048-bench [repetitions]\n");
+	printf("or, to search every position of a corpus: \n");
+	printf("USAGE: ./2048-bench corpus <file> <max/avg> <max_depth>"
+		" [generic/kernel/selective]\n");
+	printf("or, to write a new corpus from seeded self play: \n");
+	printf("USAGE: ./2048-bench make-corpus <file>\n");
+	printf("or, to fail when slower than a stored bench_results.csv: \n");
+	printf("USAGE: ./2048-bench compare <baseline> [threshold%%] "
+		"[repetitions]\n");
+}
+
+/****************************COMPARE*FUNCTION********************************/
+
+/** Welch t test that current is worse than baseline, from the summaries
+ * @param baseline Stored result
+ * @param current Result of this run
+ * @param higherIsBetter True for throughput, false for time
+ * @return bool True if current is significantly worse at 95%
+ */
+bool
+significantlyWorse(result_t *baseline, result_t *current, 
+	bool higherIsBetter) {
+	double worse = higherIsBetter ? baseline -> mean - current -> mean : 
+		current -> mean - baseline -> mean;
+	double vb = baseline -> stddev * baseline -> stddev / 
+		baseline -> repetitions;
+	double vc = current -> stddev * current -> stddev / 
+		current -> repetitions;
+	double df, t;
+
+	if (worse <= 0) {
+		return false;
+	}
+
+	// No spread at all, any difference is real
+	if (vb + vc == 0) {
+		return true;
+	}
+
+	t = worse / sqrt(vb + vc);
+
+	// Welch Satterthwaite degrees of freedom
+	df = (vb + vc) * (vb + vc) / 
+		((baseline -> repetitions > 1 ? vb * vb / 
+			(baseline -> repetitions - 1) : 0) + 
+		(current -> repetitions > 1 ? vc * vc / 
+			(current -> repetitions - 1) : 0));
+
+	if (!(df >= 1)) {
+		df = 1;
+	}
+
+	return t > (df > T_TABLE ? T_NORMAL : criticalT[(int) df - 1]);
+}
+
+/** Compare this run with a stored baseline, a metric regresses when it is
+ * worse by more than threshold percent and the t test agrees
+ * @param baseline Stored results
+ * @param nBaseline Number of stored results
+ * @param threshold Percent of slowdown tolerated
+ * @return int Number of regressed metrics
+ */
+int
+compareResults(result_t baseline[], int nBaseline, double threshold) {
+	int regressions = 0;
+	int i, j;
+
+	printf("\n%-24s %14s %14s %8s  %s\n", "metric", "baseline", "current", 
+		"change", "verdict");
+
+	for (i = 0; i < nBaseline; i ++) {
+		result_t *current = NULL;
+		for (j = 0; j < nResults; j ++) {
+			if (strcmp(results[j].name, baseline[i].name) == 0) {
+				current = &results[j];
+			}
+		}
+
+		if (current == NULL) {
+			printf("%-24s %14.2f %14s %8s  missing\n", baseline[i].name, 
+				baseline[i].mean, "-", "-");
+			continue;
+		}
+
+		bool higherIsBetter = strcmp(current -> unit, "nodes/s") == 0;
+		double change = baseline[i].mean > 0 ? PERCENT * 
+			(current -> mean - baseline[i].mean) / baseline[i].mean : 0;
+		double slowdown = higherIsBetter ? -change : change;
+		const char *verdict = "ok";
+
+		if (slowdown > threshold) {
+			if (significantlyWorse(&baseline[i], current, higherIsBetter)) {
+				verdict = "REGRESSION";
+				regressions ++;
+			}
+			else {
+				verdict = "noise";
+			}
+		}
+
+		printf("%-24s %14.2f %14.2f %+7.1f%%  %s\n", baseline[i].name, 
+			baseline[i].mean, current -> mean, change, verdict);
+	}
+
+	printf("\n%d regression(s) above %.1f%%\n", regressions, threshold);
+	return regressions;
+}
+
+/*****************************RUN*FUNCTION***********************************/
+
+/** Latency of every position of the latency corpus, once per repetition
+ * @param corpus Loaded corpus
+ * @param kernel Kernel of LATENCY_DEPTH under max, NULL for the generic 
+ * engine
+ * @param p50 Median latency of every repetition in microseconds
+ * @param p90 90th percentile of every repetition in microseconds
+ * @param p99 99th percentile of every repetition in microseconds
+ * @param repetitions Number of repetitions
+ */
+void
+benchLatency(corpus_t *corpus, const kernel_t *kernel, double p50[], 
+	double p90[], double p99[], int repetitions) {
+	int generated = 0, expanded = 0, pruned = 0;
+	metrics_t metrics;
+	int i, r;
+
+	for (r = 0; r < repetitions; r ++) {
+		initMetrics(&metrics);
+		for (i = 0; i < corpus -> n; i ++) {
+			srand(i);
+			double start = wallClock();
+			kernelMove(kernel, corpus -> boards[i], LATENCY_DEPTH, max, 
+				&generated, &expanded, &pruned);
+			recordMove(&metrics, wallClock() - start, searchMemory(), 
+				searchDegraded());
+		}
+		p50[r] = latencyPercentile(&metrics, 50) * MICROSECOND;
+		p90[r] = latencyPercentile(&metrics, 90) * MICROSECOND;
+		p99[r] = latencyPercentile(&metrics, 99) * MICROSECOND;
+		freeMetrics(&metrics);
+	}
+}
+
+/** Run every benchmark repetitions times
+ * @param repetitions Number of repetitions of every benchmark
+ */
+void
+runBenchmarks(int repetitions) {
+	static const char *moveName[NUMBER_OF_MOVES] = {
+		"execute_move_t/left", "execute_move_t/right", "execute_move_t/up", 
+		"execute_move_t/down"
+	};
+	char name[MAX_NAME];
+	double *samples, *nodes, *tail;
+	corpus_t corpus;
+	int i, r, depth;
+
+	samples = (double *) malloc(sizeof(double) * repetitions);
+	nodes = (double *) malloc(sizeof(double) * repetitions);
+	tail = (double *) malloc(sizeof(double) * repetitions);
+	assert(samples != NULL && nodes != NULL && tail != NULL);
+
+	generatePositions(POSITION_SEED);
+	printf("%d positions, %d repetitions\n\n", POSITIONS, repetitions);
+
+	for (r = 0; r < repetitions; r ++) samples[r] = benchCopy();
+	report("copyBoard", "ns/op", samples, repetitions);
+
+	for (i = 0; i < NUMBER_OF_MOVES; i ++) {
+		for (r = 0; r < repetitions; r ++) samples[r] = benchMove(i);
+		report(moveName[i], "ns/op", samples, repetitions);
+	}
+
+	for (r = 0; r < repetitions; r ++) samples[r] = benchGameEnded();
+	report("gameEnded", "ns/op", samples, repetitions);
+
+	for (r = 0; r < repetitions; r ++) samples[r] = benchAddRandom();
+	report("addRandom", "ns/op", samples, repetitions);
+
+	for (r = 0; r < repetitions; r ++) samples[r] = benchSelfPlay(0);
+	report("selfplay_scalar", "ns/move", samples, repetitions);
+
+	for (r = 0; r < repetitions; r ++) {
+		samples[r] = benchSelfPlay(LOCKSTEP_LANES);
+	}
+	report("selfplay_lockstep", "ns/move", samples, repetitions);
+
+	for (r = 0; r < repetitions; r ++) samples[r] = benchHeap(POSITION_SEED);
+	report("heap_push+heap_delete", "ns/op", samples, repetitions);
+
+	for (r = 0; r < repetitions; r ++) samples[r] = benchNodes();
+	report("createNewNode+free", "ns/op", samples, repetitions);
+
+	for (r = 0; r < repetitions; r ++) samples[r] = benchArenaNodes();
+	report("createNewNode+resetArena", "ns/op", samples, repetitions);
+
+	for (depth = MIN_SEARCH_DEPTH; depth <= MAX_SEARCH_DEPTH; depth ++) {
+		for (r = 0; r < repetitions; r ++) {
+			samples[r] = benchSearch(depth, NULL, &nodes[r]);
+		}
+		snprintf(name, MAX_NAME, "get_next_move/%d", depth);
+		report(name, "us/move", samples, repetitions);
+		snprintf(name, MAX_NAME, "nodes_per_second/%d", depth);
+		report(name, "nodes/s", nodes, repetitions);
+	}
+
+	// The kernels are what ./2048 ai max runs at these depths
+	for (depth = MIN_SEARCH_DEPTH; depth <= MAX_SEARCH_DEPTH; depth ++) {
+		const kernel_t *kernel = findKernel(depth, max);
+		if (kernel == NULL) {
+			continue;
+		}
+		for (r = 0; r < repetitions; r ++) {
+			samples[r] = benchSearch(depth, kernel, &nodes[r]);
+		}
+		snprintf(name, MAX_NAME, "kernel/%d", depth);
+		report(name, "us/move", samples, repetitions);
+		snprintf(name, MAX_NAME, "kernel_nodes_per_second/%d", depth);
+		report(name, "nodes/s", nodes, repetitions);
+	}
+
+	// Per move latency percentiles over the standard corpus
+	initCorpus(&corpus);
+	if (loadCorpus(&corpus, LATENCY_CORPUS)) {
+		benchLatency(&corpus, NULL, samples, nodes, tail, repetitions);
+		snprintf(name, MAX_NAME, "latency_p50/%d", LATENCY_DEPTH);
+		report(name, "us", samples, repetitions);
+		snprintf(name, MAX_NAME, "latency_p90/%d", LATENCY_DEPTH);
+		report(name, "us", nodes, repetitions);
+		snprintf(name, MAX_NAME, "latency_p99/%d", LATENCY_DEPTH);
+		report(name, "us", tail, repetitions);
+
+		benchLatency(&corpus, findKernel(LATENCY_DEPTH, max), samples, nodes,
+			tail, repetitions);
+		snprintf(name, MAX_NAME, "kernel_latency_p50/%d", LATENCY_DEPTH);
+		report(name, "us", samples, repetitions);
+		snprintf(name, MAX_NAME, "kernel_latency_p90/%d", LATENCY_DEPTH);
+		report(name, "us", nodes, repetitions);
+		snprintf(name, MAX_NAME, "kernel_latency_p99/%d", LATENCY_DEPTH);
+		report(name, "us", tail, repetitions);
+	}
+	else {
+		printf("%s not found, latency skipped\n", LATENCY_CORPUS);
+	}
+	freeCorpus(&corpus);
+
+	printResults();
+
+	free(samples);
+	free(nodes);
+	free(tail);
+}
+
+/*****************************MAIN*FUNCTION**********************************/
+
+/** Run every benchmark repetitions times, compare them with a baseline, 
+ * or one of the corpus modes
+ */
+int 
+main(int argc, char *argv[]) {
+	result_t baseline[MAX_RESULTS];
+	double threshold = DEFAULT_THRESHOLD;
+	int repetitions = DEFAULT_REPETITIONS;
+	int depth, nBaseline, status;
+
+	initialize_ai();
+
+	if ((argc == 5 || argc == 6) && strcmp(argv[1], "corpus") == 0 && 
+		(strcmp(argv[3], "max") == 0 || strcmp(argv[3], "avg") == 0) && 
+		sscanf(argv[4], "%d", &depth) == 1) {
+		propagation_t propagation = strcmp(argv[3], "max") == 0 ? max : avg;
+		selective_t selective = {argc == 6 && 
+			strcmp(argv[5], "selective") == 0, 0};
+
+		// Depths without a kernel are searched by the generic engine
+		status = benchCorpus(argv[2], propagation, depth, argc == 6 && 
+			strcmp(argv[5], "kernel") == 0 ? findKernel(depth, propagation) :
+			NULL, selective);
+	}
+	else if (argc == 3 && strcmp(argv[1], "make-corpus") == 0) {
+		status = makeCorpus(argv[2]);
+	}
+	else if (argc >= 3 && argc <= 5 && strcmp(argv[1], "compare") == 0 && 
+		(argc < 4 || sscanf(argv[3], "%lf", &threshold) == 1) && 
+		(argc < 5 || (sscanf(argv[4], "%d", &repetitions) == 1 && 
+			repetitions > 1))) {
+		nBaseline = loadResults(argv[2], baseline);
+		if (nBaseline <= 0) {
+			fprintf(stderr, "can not read baseline %s\n", argv[2]);
+			status = EXIT_FAILURE;
+		}
+		else {
+			// Same number of repetitions as the baseline unless given
+			if (argc < 5) {
+				repetitions = baseline[0].repetitions > 1 ? 
+					baseline[0].repetitions : DEFAULT_REPETITIONS;
+			}
+			runBenchmarks(repetitions);
+			status = compareResults(baseline, nBaseline, threshold) ? 
+				EXIT_FAILURE : EXIT_SUCCESS;
+		}
+	}
+	else if (argc == 1 || (argc == 2 && 
+		sscanf(argv[1], "%d", &repetitions) == 1 && repetitions > 0)) {
+		runBenchmarks(repetitions);
+		status = EXIT_SUCCESS;
+	}
+	else {
+		printBenchUsage();
+		status = EXIT_FAILURE;
+	}
+
+	freeAI();
+	return status;
+}
@@ -0,0 +1,421 @@
+/*
+ ============================================================================
+ Name        : book.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Opening book of early positions searched deep offline
+ ============================================================================
+ */
+
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "book.h"
+#include "ai.h"
+#include "lockstep.h"
+#include "metrics.h"
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Work shared with the threads building the book, first the games that
+ * gather positions then the deep search of every distinct position
+ */
+typedef struct build_s {
+	uint64_t *gathered; // plies canonical boards per game, 0 once over
+	int plies;
+	int playDepth;
+	uint64_t *boards; // distinct positions entering the book
+	uint8_t *moves;
+	int depth;
+	propagation_t propagation;
+	uint32_t seed;
+	bool searching; // false while gathering
+	int jobs;
+	int next;
+	uint64_t expanded;
+} build_t;
+
+/*****************************SYMMETRY*FUNCTION******************************/
+
+/** Apply a symmetry to the board
+ * @param board Board to be transformed
+ * @param symmetry Combination of BOOK_SWAP, BOOK_FLIP_ROWS, BOOK_FLIP_COLUMNS
+ * @param transformed Board after the symmetry
+ */
+static void
+transformBoard(uint8_t board[SIZE][SIZE], int symmetry,
+	uint8_t transformed[SIZE][SIZE]) {
+	int i, j;
+
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j ++) {
+			int row = symmetry & BOOK_SWAP ? j : i;
+			int column = symmetry & BOOK_SWAP ? i : j;
+			row = symmetry & BOOK_FLIP_ROWS ? SIZE - 1 - row : row;
+			column = symmetry & BOOK_FLIP_COLUMNS ? SIZE - 1 - column : column;
+			transformed[row][column] = board[i][j];
+		}
+	}
+}
+
+/** Move on the transformed board that matches a move on the board, left
+ * and right slide the columns (towards row 0 and SIZE - 1), up and down
+ * slide the rows (towards column 0 and SIZE - 1)
+ * @param move Move on the board
+ * @param symmetry Symmetry applied to the board
+ * @return move Same move after the symmetry
+ */
+move_t
+transformMove(move_t move, int symmetry) {
+	bool columns = move == left || move == right;
+	bool reversed = move == right || move == down;
+
+	if (symmetry & BOOK_SWAP) {
+		columns = !columns;
+	}
+	if (symmetry & (columns ? BOOK_FLIP_ROWS : BOOK_FLIP_COLUMNS)) {
+		reversed = !reversed;
+	}
+
+	return columns ? (reversed ? right : left) : (reversed ? down : up);
+}
+
+/** Canonical form of the board, smallest packed board of its symmetries
+ * @param board Board to be canonicalised
+ * @param symmetry Symmetry that gives the canonical form
+ * @return canonical Packed canonical board
+ */
+uint64_t
+canonicalBoard(uint8_t board[SIZE][SIZE], int *symmetry) {
+	uint8_t transformed[SIZE][SIZE];
+	uint64_t canonical = UINT64_MAX;
+	int k;
+
+	for (k = 0; k < BOOK_SYMMETRIES; k ++) {
+		transformBoard(board, k, transformed);
+		uint64_t packed = packBoard(transformed);
+		if (packed < canonical) {
+			canonical = packed;
+			*symmetry = k;
+		}
+	}
+
+	return canonical;
+}
+
+/*****************************LOOKUP*FUNCTION********************************/
+
+/** Map a book file
+ * @param book Book to be opened
+ * @param path File written by buildBook
+ * @return bool False if it can not be read or is not a book
+ */
+bool
+openBook(book_t *book, const char *path) {
+	struct stat info;
+	uint32_t count;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	if (fstat(fd, &info) != 0 || info.st_size < BOOK_HEADER) {
+		close(fd);
+		return false;
+	}
+
+	const uint8_t *data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED,
+		fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	memcpy(&count, data + BOOK_MAGIC_LENGTH, sizeof(count));
+	if (memcmp(data, BOOK_MAGIC, BOOK_MAGIC_LENGTH) != 0 ||
+		(size_t) info.st_size != BOOK_HEADER + (size_t) count *
+		(sizeof(uint64_t) + sizeof(uint8_t))) {
+		munmap((void *) data, info.st_size);
+		return false;
+	}
+
+	book -> data = data;
+	book -> size = info.st_size;
+	book -> count = count;
+	book -> boards = (const uint64_t *) (data + BOOK_HEADER);
+	book -> moves = data + BOOK_HEADER + (size_t) count * sizeof(uint64_t);
+	book -> depth = data[BOOK_MAGIC_LENGTH + sizeof(count)];
+	book -> propagation = data[BOOK_MAGIC_LENGTH + sizeof(count) + 1] == avg ?
+		avg : max;
+	return true;
+}
+
+/** Find the move of the board in the book
+ * @param book Opened book
+ * @param board The condition of the current board
+ * @param move Book move for the board, only set if found
+ * @return bool True if the board is in the book and its move is legal
+ */
+bool
+lookupBook(book_t *book, uint8_t board[SIZE][SIZE], move_t *move) {
+	uint8_t moved[SIZE][SIZE];
+	uint32_t low = 0, high = book -> count, score = 0;
+	int symmetry = 0, k;
+
+	uint64_t canonical = canonicalBoard(board, &symmetry);
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (book -> boards[middle] < canonical) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	if (low == book -> count || book -> boards[low] != canonical) {
+		return false;
+	}
+
+	// Move of the board whose symmetry is the book move
+	for (k = 0; k < NUMBER_OF_MOVES &&
+		transformMove(k, symmetry) != book -> moves[low]; k ++);
+
+	/* Tiles above NIBBLE do not survive packBoard, so the move is checked
+	 * on the board itself
+	 */
+	copyBoard(moved, board);
+	if (k == NUMBER_OF_MOVES || !execute_move_t(moved, &score, k)) {
+		return false;
+	}
+
+	*move = k;
+	return true;
+}
+
+/** Unmap the book
+ * @param book Opened book
+ */
+void
+closeBook(book_t *book) {
+	munmap((void *) book -> data, book -> size);
+}
+
+/*****************************BUILD*FUNCTION*********************************/
+
+/** Play the first plies moves of a seeded game and keep its positions,
+ * ties are broken from the game and the ply so the book does not depend on
+ * the threads
+ * @param build Work shared with the other threads
+ * @param game Index of the game
+ */
+static void
+gatherGame(build_t *build, int game) {
+	uint8_t board[SIZE][SIZE];
+	uint64_t *gathered = build -> gathered + (size_t) game * build -> plies;
+	uint32_t seed = gameSeed(build -> seed, game), first = seed, score = 0;
+	int generated = 0, expanded = 0, pruned = 0, ply, symmetry;
+
+	memset(board, 0, sizeof(board));
+	addRandomSeeded(board, &seed);
+	addRandomSeeded(board, &seed);
+
+	for (ply = 0; ply < build -> plies; ply ++) {
+		if (gameEnded(board)) {
+			gathered[ply] = 0;
+			continue;
+		}
+
+		gathered[ply] = canonicalBoard(board, &symmetry);
+		setTieBreak(gameSeed(first, ply));
+		move_t move = get_next_move(board, build -> playDepth,
+			build -> propagation, &generated, &expanded, &pruned);
+		if (execute_move_t(board, &score, move)) {
+			addRandomSeeded(board, &seed);
+		}
+	}
+}
+
+/** Thread building the book, takes games or positions until none is left
+ * @param arg Work shared with the other threads
+ */
+static void
+*bookWorker(void *arg) {
+	build_t *build = (build_t *) arg;
+	uint8_t board[SIZE][SIZE];
+	int generated = 0, expanded = 0, pruned = 0, i;
+
+	initialize_ai();
+
+	while ((i = __atomic_fetch_add(&build -> next, 1, __ATOMIC_RELAXED)) <
+		build -> jobs) {
+		if (!build -> searching) {
+			gatherGame(build, i);
+			continue;
+		}
+
+		// Canonical boards are searched as they are, moves stay canonical
+		unpackBoard(build -> boards[i], board);
+		setTieBreak(gameSeed(build -> seed, i));
+		build -> moves[i] = searchMove(board, build -> depth,
+			build -> propagation, NULL, NULL, &generated, &expanded, &pruned);
+	}
+
+	__atomic_fetch_add(&build -> expanded, expanded, __ATOMIC_RELAXED);
+	freeAI();
+	return NULL;
+}
+
+/** Run the jobs of the build on threads and wait for them
+ * @param build Work shared with the threads
+ * @param threads Number of threads
+ * @param jobs Games or positions to be processed
+ */
+static void
+runBuild(build_t *build, int threads, int jobs) {
+	pthread_t *workers = (pthread_t *) malloc(sizeof(pthread_t) * threads);
+	assert(workers != NULL);
+	int i;
+
+	build -> jobs = jobs;
+	build -> next = 0;
+	for (i = 0; i < threads; i ++) {
+		pthread_create(&workers[i], NULL, bookWorker, build);
+	}
+	for (i = 0; i < threads; i ++) {
+		pthread_join(workers[i], NULL);
+	}
+
+	free(workers);
+}
+
+/** Order of packed boards for qsort
+ * @param a First board
+ * @param b Second board
+ * @return int Negative, zero or positive
+ */
+static int
+compareBoards(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+/** ./2048 book <output> [--games n] [--plies n] [--min-count n]
+ * [--play-depth n] [--depth n] [--mode max|avg] [--threads n] [--seed n],
+ * gathers the openings of seeded games, keeps the canonical positions seen
+ * at least min-count times and searches each of them at depth
+ * @param argc Number of arguments
+ * @param argv Arguments, argv[1] is book
+ * @return int Exit status
+ */
+int
+buildBook(int argc, char *argv[]) {
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int games = BOOK_GAMES, minCount = BOOK_MIN_COUNT;
+	uint32_t count = 0;
+	size_t total, i, run;
+	build_t build;
+	int k;
+
+	build.plies = BOOK_PLIES;
+	build.playDepth = BOOK_PLAY_DEPTH;
+	build.depth = BOOK_DEPTH;
+	build.propagation = max;
+	build.seed = BOOK_SEED;
+	build.expanded = 0;
+	for (k = 3; k < argc; k ++) {
+		if (strcmp(argv[k], "--games") == 0 && k + 1 < argc) {
+			sscanf(argv[++ k], "%d", &games);
+		}
+		else if (strcmp(argv[k], "--plies") == 0 && k + 1 < argc) {
+			sscanf(argv[++ k], "%d", &build.plies);
+		}
+		else if (strcmp(argv[k], "--min-count") == 0 && k + 1 < argc) {
+			sscanf(argv[++ k], "%d", &minCount);
+		}
+		else if (strcmp(argv[k], "--play-depth") == 0 && k + 1 < argc) {
+			sscanf(argv[++ k], "%d", &build.playDepth);
+		}
+		else if (strcmp(argv[k], "--depth") == 0 && k + 1 < argc) {
+			sscanf(argv[++ k], "%d", &build.depth);
+		}
+		else if (strcmp(argv[k], "--mode") == 0 && k + 1 < argc) {
+			build.propagation = strcmp(argv[++ k], "avg") == 0 ? avg : max;
+		}
+		else if (strcmp(argv[k], "--threads") == 0 && k + 1 < argc) {
+			sscanf(argv[++ k], "%d", &threads);
+		}
+		else if (strcmp(argv[k], "--seed") == 0 && k + 1 < argc) {
+			sscanf(argv[++ k], "%u", &build.seed);
+		}
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[k]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (games < 1 || build.plies < 1 || build.playDepth < 1 ||
+		build.depth < 1) {
+		fprintf(stderr, "games, plies and depths must be positive\n");
+		return EXIT_FAILURE;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	// Openings of the seeded games, 0 marks plies after the game over
+	double start = wallClock();
+	total = (size_t) games * build.plies;
+	build.gathered = (uint64_t *) malloc(sizeof(uint64_t) * total);
+	assert(build.gathered != NULL);
+	build.searching = false;
+	runBuild(&build, threads, games);
+
+	// Distinct positions seen at least minCount times, sorted
+	qsort(build.gathered, total, sizeof(uint64_t), compareBoards);
+	for (i = 0; i < total; i += run) {
+		for (run = 1; i + run < total &&
+			build.gathered[i + run] == build.gathered[i]; run ++);
+		if (build.gathered[i] != 0 && run >= (size_t) minCount) {
+			build.gathered[count ++] = build.gathered[i];
+		}
+	}
+	build.boards = build.gathered;
+	build.moves = (uint8_t *) malloc(count > 0 ? count : 1);
+	assert(build.moves != NULL);
+	double gathered = wallClock();
+
+	build.searching = true;
+	runBuild(&build, threads, count);
+	double end = wallClock();
+
+	/** File open */
+	FILE *fp = fopen(argv[2], "w");
+	if (fp == NULL) {
+		fprintf(stderr, "can not write %s\n", argv[2]);
+		free(build.gathered);
+		free(build.moves);
+		return EXIT_FAILURE;
+	}
+
+	uint8_t header[BOOK_HEADER] = {0};
+	memcpy(header, BOOK_MAGIC, BOOK_MAGIC_LENGTH);
+	memcpy(header + BOOK_MAGIC_LENGTH, &count, sizeof(count));
+	header[BOOK_MAGIC_LENGTH + sizeof(count)] = build.depth;
+	header[BOOK_MAGIC_LENGTH + sizeof(count) + 1] = build.propagation;
+	fwrite(header, 1, BOOK_HEADER, fp);
+	fwrite(build.boards, sizeof(uint64_t), count, fp);
+	fwrite(build.moves, sizeof(uint8_t), count, fp);
+	fclose(fp);
+
+	fprintf(stderr, "%u positions from %d games (%.3f s), searched at depth "
+		"%d with %d threads (%.3f s, %.0f nodes/s)\n", count, games,
+		gathered - start, build.depth, threads, end - gathered,
+		build.expanded / (end - gathered < EPSILON ? EPSILON :
+		end - gathered));
+
+	free(build.gathered);
+	free(build.moves);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+/*
+ ============================================================================
+ Name        : book.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Opening book of early positions searched deep offline
+ ============================================================================
+ */
+
+#ifndef __BOOK__
+#define __BOOK__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * Boards are stored in canonical form, the smallest packBoard among the 8
+ * symmetries of the board, with the best move in that orientation. File:
+ *     magic(8 bytes) count(u32) depth(u8) propagation(u8) reserved(2 bytes)
+ *     boards(u64 * count, sorted) moves(u8 * count)
+ * little endian, so boards can be searched in place once mapped
+ */
+#define BOOK_MAGIC "2048BK01"
+#define BOOK_MAGIC_LENGTH 8
+#define BOOK_HEADER 16
+#define BOOK_SYMMETRIES 8
+#define BOOK_SWAP 4 // symmetry bit, exchange rows and columns
+#define BOOK_FLIP_ROWS 1 // symmetry bit, reverse the order of the rows
+#define BOOK_FLIP_COLUMNS 2 // symmetry bit, reverse the order of the columns
+#define BOOK_GAMES 20000 // games whose openings are gathered
+#define BOOK_PLIES 30 // moves of every game gathered
+#define BOOK_MIN_COUNT 3 // occurrences for a position to enter the book
+#define BOOK_PLAY_DEPTH 2 // depth of the games that gather positions
+#define BOOK_DEPTH 8 // depth of the search of every book position
+#define BOOK_SEED 2048u
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Book mapped from its file
+ */
+typedef struct book_s {
+	const uint8_t *data;
+	size_t size;
+	const uint64_t *boards;
+	const uint8_t *moves;
+	uint32_t count;
+	int depth;
+	propagation_t propagation;
+} book_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+uint64_t canonicalBoard(uint8_t board[SIZE][SIZE], int *symmetry);
+move_t transformMove(move_t move, int symmetry);
+bool openBook(book_t *book, const char *path);
+bool lookupBook(book_t *book, uint8_t board[SIZE][SIZE], move_t *move);
+void closeBook(book_t *book);
+int buildBook(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,324 @@
+/*
+ ============================================================================
+ Name        : compare.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Sequential A/B comparison of two configurations
+ ============================================================================
+ */
+
+#include "compare.h"
+#include "ai.h"
+#include "tune.h"
+#include "pool.h"
+#include "metrics.h"
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Configuration of the search, written mode:depth[s][:weights] on the 
+ * command line, s for the selective search
+ */
+typedef struct config_s {
+	const char *name;
+	propagation_t propagation;
+	int depth;
+	selective_t selective;
+	const kernel_t *kernel; // kernel the ai command would use, or NULL
+	weights_t weights;
+} config_t;
+
+/**
+ * One game of one configuration
+ */
+typedef struct outcome_s {
+	game_t game;
+	int expanded;
+	double cpu; // seconds of the thread that played the game
+} outcome_t;
+
+/**
+ * Games of a batch shared with the worker pool, job i is configuration
+ * i % COMPARE_CONFIGS of pair first + i / COMPARE_CONFIGS
+ */
+typedef struct compare_s {
+	config_t configs[COMPARE_CONFIGS];
+	outcome_t *outcomes; // indexed by pair * COMPARE_CONFIGS + configuration
+	uint32_t seed;
+	int first;
+} compare_t;
+
+/**
+ * Sequential probability ratio test, decision is 1 once A is better, -1
+ * once B is better and 0 while undecided
+ */
+typedef struct sprt_s {
+	double llr;
+	int decision;
+	int pairs; // pairs seen when it decided
+} sprt_t;
+
+/*****************************WORKER*FUNCTION********************************/
+
+/** CPU time of the calling thread
+ * @return seconds CPU seconds used by the thread so far
+ */
+static double
+threadClock() {
+	struct timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/** Job of the pool, plays one game of the batch with its configuration
+ * @param context Games shared with the other workers
+ * @param i Index of the job in the batch
+ */
+static void
+compareGame(void *context, int i) {
+	compare_t *compare = (compare_t *) context;
+	int pair = compare -> first + i / COMPARE_CONFIGS;
+	config_t *config = &compare -> configs[i % COMPARE_CONFIGS];
+	outcome_t *outcome = &compare -> outcomes[pair * COMPARE_CONFIGS +
+		i % COMPARE_CONFIGS];
+
+	setWeights(&config -> weights);
+	setSelective(&config -> selective);
+	outcome -> expanded = 0;
+	double start = threadClock();
+	playSeededGame(gameSeed(compare -> seed, pair), config -> depth,
+		config -> propagation, config -> kernel, &outcome -> game, 
+		&outcome -> expanded);
+	outcome -> cpu = threadClock() - start;
+}
+
+/*****************************TEST*FUNCTION**********************************/
+
+/** Parse a configuration written mode:depth[s][:weights]
+ * @param text Configuration from the command line
+ * @param config Configuration to be filled
+ * @return bool False if text is not a configuration
+ */
+static bool
+parseConfig(const char *text, config_t *config) {
+	char mode[MODE_LENGTH];
+	const char *weights;
+	weights_t defaults = DEFAULT_WEIGHTS;
+	int length = 0;
+
+	config -> name = text;
+	config -> weights = defaults;
+	if (sscanf(text, "%3[a-z]:%d%n", mode, &config -> depth, &length) != 2 ||
+		config -> depth < 1) {
+		return false;
+	}
+	config -> selective.enabled = text[length] == 's';
+	config -> selective.nodeBudget = 0;
+	if (strcmp(mode, "max") == 0) {
+		config -> propagation = max;
+	}
+	else if (strcmp(mode, "avg") == 0) {
+		config -> propagation = avg;
+	}
+	else {
+		return false;
+	}
+
+	// Same engine as ./2048 ai, so the cpu cost is the one of production
+	config -> kernel = config -> selective.enabled ? NULL : 
+		findKernel(config -> depth, config -> propagation);
+
+	weights = strchr(strchr(text, ':') + 1, ':');
+	return weights == NULL || loadWeights(weights + 1, &config -> weights);
+}
+
+/** Decide the test once its log likelihood ratio leaves the bounds
+ * @param test Test to be updated
+ * @param llr Log likelihood ratio of A better against B better
+ * @param pairs Pairs seen so far
+ * @param alpha Error of declaring A better when B is
+ * @param beta Error of declaring B better when A is
+ */
+static void
+decideTest(sprt_t *test, double llr, int pairs, double alpha, double beta) {
+	test -> llr = llr;
+	if (llr >= log((1 - beta) / alpha)) {
+		test -> decision = 1;
+	}
+	else if (llr <= log(beta / (1 - alpha))) {
+		test -> decision = -1;
+	}
+	test -> pairs = pairs;
+}
+
+/** Name of the outcome of a test
+ * @param test Test to be described
+ * @return name Better configuration or undecided
+ */
+static const char
+*decisionName(sprt_t *test) {
+	return test -> decision > 0 ? "A better" : test -> decision < 0 ?
+		"B better" : "undecided";
+}
+
+/** ./2048 compare <mode:depth[s][:weights]> <mode:depth[s][:weights]>
+ * [--alpha a] [--beta b] [--delta d] [--epsilon e] [--target tile]
+ * [--max-games n] [--threads n] [--seed n], plays pairs of seeded games
+ * until the score and reach tests have both decided. A configuration
+ * compared with itself fails unless every pair is a tie
+ * @param argc Number of arguments
+ * @param argv Arguments, argv[1] is compare
+ * @return int Exit status
+ */
+int
+compareConfigs(int argc, char *argv[]) {
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int maxGames = COMPARE_MAX_GAMES, target = COMPARE_TARGET, tile;
+	double alpha = COMPARE_ALPHA, beta = COMPARE_BETA;
+	double delta = COMPARE_DELTA, epsilon = COMPARE_EPSILON;
+	double sum = 0, sumSquares = 0, total[COMPARE_CONFIGS] = {0};
+	double cpu[COMPARE_CONFIGS] = {0}, expanded[COMPARE_CONFIGS] = {0};
+	int reached[COMPARE_CONFIGS] = {0}, alone[COMPARE_CONFIGS] = {0};
+	sprt_t score = {0, 0, 0}, reach = {0, 0, 0};
+	int played = 0, pairs = 0, differ = 0, c, i;
+	compare_t compare;
+	pool_t pool;
+
+	compare.seed = COMPARE_SEED;
+	for (i = 4; i < argc; i ++) {
+		if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%lf", &alpha);
+		}
+		else if (strcmp(argv[i], "--beta") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%lf", &beta);
+		}
+		else if (strcmp(argv[i], "--delta") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%lf", &delta);
+		}
+		else if (strcmp(argv[i], "--epsilon") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%lf", &epsilon);
+		}
+		else if (strcmp(argv[i], "--target") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &tile);
+			for (target = 0; (1 << target) < tile; target ++);
+		}
+		else if (strcmp(argv[i], "--max-games") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &maxGames);
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &threads);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%u", &compare.seed);
+		}
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	for (c = 0; c < COMPARE_CONFIGS; c ++) {
+		if (!parseConfig(argv[2 + c], &compare.configs[c])) {
+			fprintf(stderr, "bad configuration %s, expected "
+				"<max|avg>:<depth>[s][:weights]\n", argv[2 + c]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (alpha <= 0 || alpha >= 1 || beta <= 0 || beta >= 1 || delta <= 0 ||
+		epsilon <= 0 || epsilon >= 0.5 || maxGames < 1) {
+		fprintf(stderr, "alpha, beta in (0, 1), delta > 0, epsilon in "
+			"(0, 0.5) and max-games > 0\n");
+		return EXIT_FAILURE;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	compare.outcomes = (outcome_t *) malloc(sizeof(outcome_t) *
+		COMPARE_CONFIGS * maxGames);
+	assert(compare.outcomes != NULL);
+	initPool(&pool, threads, compareGame, NULL, &compare);
+
+	double start = wallClock();
+	while (pairs < maxGames && (score.decision == 0 || reach.decision == 0)) {
+		// Play a batch of pairs, then feed the tests in seed order
+		int batch = threads * COMPARE_BATCH;
+		batch = batch < maxGames - played ? batch : maxGames - played;
+		compare.first = played;
+		runPool(&pool, batch * COMPARE_CONFIGS);
+
+		for (i = played * COMPARE_CONFIGS; i < (played + batch) *
+			COMPARE_CONFIGS; i ++) {
+			cpu[i % COMPARE_CONFIGS] += compare.outcomes[i].cpu;
+			expanded[i % COMPARE_CONFIGS] += compare.outcomes[i].expanded;
+		}
+		played += batch;
+
+		// Pairs after both tests decided are played but not counted
+		for (; pairs < played && (score.decision == 0 ||
+			reach.decision == 0); pairs ++) {
+			outcome_t *pair = &compare.outcomes[pairs * COMPARE_CONFIGS];
+			double difference = (double) pair[0].game.score -
+				pair[1].game.score;
+			int n = pairs + 1;
+
+			sum += difference;
+			sumSquares += difference * difference;
+			differ += pair[0].game.score != pair[1].game.score ||
+				pair[0].game.turns != pair[1].game.turns;
+			for (c = 0; c < COMPARE_CONFIGS; c ++) {
+				total[c] += pair[c].game.score;
+				reached[c] += pair[c].game.maxTile >= target;
+			}
+			if ((pair[0].game.maxTile >= target) !=
+				(pair[1].game.maxTile >= target)) {
+				alone[pair[0].game.maxTile >= target ? 0 : 1] ++;
+			}
+
+			// Normal approximation, variance estimated from the pairs
+			if (score.decision == 0 && n >= COMPARE_MIN_GAMES) {
+				double variance = (sumSquares - sum * sum / n) / (n - 1);
+				double shift = delta * (total[0] + total[1]) /
+					(COMPARE_CONFIGS * n);
+				variance = variance < 1 ? 1 : variance;
+				decideTest(&score, 2 * shift * sum / variance, n, alpha, beta);
+			}
+
+			// Only the pairs where one configuration alone reached count
+			if (reach.decision == 0) {
+				decideTest(&reach, (alone[0] - alone[1]) *
+					log((0.5 + epsilon) / (0.5 - epsilon)), n, alpha, beta);
+			}
+		}
+	}
+	double end = wallClock();
+	freePool(&pool);
+
+	double mean = sum / pairs;
+	double error = pairs > 1 ? 1.96 * sqrt((sumSquares - sum * sum / pairs) /
+		(pairs - 1) / pairs) : 0;
+	for (c = 0; c < COMPARE_CONFIGS; c ++) {
+		printf("%c          %s: score %.1f, reach %d %.1f%%, cpu %.3f s "
+			"(%.4f s/game, %s), %.0f nodes/game\n", 'A' + c,
+			compare.configs[c].name, total[c] / pairs, 1 << target,
+			100.0 * reached[c] / pairs, cpu[c], cpu[c] / played,
+			compare.configs[c].kernel != NULL ? "kernel" : "generic",
+			expanded[c] / played);
+	}
+	printf("pairs      %d tested, %d played, %d threads, %.3f s\n", pairs,
+		played, threads, end - start);
+	printf("score      %s, llr %.3f after %d pairs, A - B = %.1f +- %.1f\n",
+		decisionName(&score), score.llr, score.pairs, mean, error);
+	printf("reach      %s, llr %.3f after %d pairs, %d A only, %d B only\n",
+		decisionName(&reach), reach.llr, reach.pairs, alone[0], alone[1]);
+
+	free(compare.outcomes);
+
+	// The same configuration on the same seeds must play the same games
+	if (strcmp(argv[2], argv[3]) == 0 && differ) {
+		fprintf(stderr, "%d of %d pairs of %s against itself differ, games "
+			"depend on more than their seed\n", differ, pairs, argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
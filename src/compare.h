@@ -0,0 +1,43 @@
+/*
+ ============================================================================
+ Name        : compare.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Sequential A/B comparison of two configurations
+ ============================================================================
+ */
+
+#ifndef __COMPARE__
+#define __COMPARE__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * Both configurations play the same seeded games in pairs, spawns and tie
+ * breaks included (playSeededGame), so a configuration compared with 
+ * itself ties every pair and compareConfigs fails if it does not. Two Wald
+ * SPRT run over the pairs in seed order, so the outcome does not depend on
+ * the threads: the mean paired score difference (normal approximation, +delta
+ * against -delta of the mean score) and the pairs where only one reached
+ * the target tile (A alone with probability 1/2 + epsilon against 1/2 - 
+ * epsilon). The comparison stops once both tests have decided
+ */
+#define COMPARE_ALPHA 0.05 // error of declaring A better when B is
+#define COMPARE_BETA 0.05 // error of declaring B better when A is
+#define COMPARE_DELTA 0.05 // relative score difference worth detecting
+#define COMPARE_EPSILON 0.1
+#define COMPARE_TARGET 11 // exponent of the target tile, 2048
+#define COMPARE_MAX_GAMES 2000 // pairs played at most
+#define COMPARE_MIN_GAMES 8 // pairs before the variance is trusted
+#define COMPARE_BATCH 4 // pairs per worker between two tests
+#define COMPARE_SEED 2048u
+#define COMPARE_CONFIGS 2
+#define MODE_LENGTH 4 // max or avg
+
+/****************************FUNCTION-DECLARATION****************************/
+
+int compareConfigs(int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,213 @@
+/*
+ ============================================================================
+ Name        : corpus.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Versioned corpus of positions used as fixed search workload
+ ============================================================================
+ */
+
+#include "corpus.h"
+#include "ai.h"
+
+/*****************************CORPUS*FUNCTION********************************/
+
+/** Initialize an empty corpus
+ * @param corpus Corpus to be initialized
+ */
+void
+initCorpus(corpus_t *corpus) {
+	corpus -> n = 0;
+	corpus -> size = CORPUS_PER_STAGE;
+	corpus -> boards = malloc(sizeof(*corpus -> boards) * corpus -> size);
+	corpus -> stage = (char *) malloc(sizeof(char) * corpus -> size);
+	assert(corpus -> boards != NULL && corpus -> stage != NULL);
+}
+
+/** Append a position to the corpus
+ * @param corpus Corpus to be inserted
+ * @param board Position to be copied
+ * @param stage Stage of the game of the position
+ */
+void
+insertIntoCorpus(corpus_t *corpus, uint8_t board[SIZE][SIZE], char stage) {
+	// Realloc if neccessary
+	if (corpus -> n == corpus -> size) {
+		corpus -> size *= REALLOC_FACTOR;
+		corpus -> boards = realloc(corpus -> boards, 
+			sizeof(*corpus -> boards) * corpus -> size);
+		corpus -> stage = realloc(corpus -> stage, 
+			sizeof(char) * corpus -> size);
+		assert(corpus -> boards != NULL && corpus -> stage != NULL);
+	}
+
+	copyBoard(corpus -> boards[corpus -> n], board);
+	corpus -> stage[corpus -> n ++] = stage;
+}
+
+/** Free the corpus
+ * @param corpus Corpus to be freed
+ */
+void
+freeCorpus(corpus_t *corpus) {
+	free(corpus -> boards);
+	free(corpus -> stage);
+}
+
+/*****************************FORMAT*FUNCTION********************************/
+
+/** Parse a board written as SIZE * SIZE hex exponents, row by row
+ * @param text Text starting with the board
+ * @param board Parsed board
+ * @return bool False if the text is not a board
+ */
+bool
+parseBoard(const char *text, uint8_t board[SIZE][SIZE]) {
+	int i, j, value;
+
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j++) {
+			char c = *text ++;
+			if (c >= '0' && c <= '9') {
+				value = c - '0';
+			}
+			else if (c >= 'a' && c <= 'f') {
+				value = c - 'a' + 10;
+			}
+			else {
+				return false;
+			}
+			board[i][j] = value;
+		}
+	}
+
+	return true;
+}
+
+/** Write a board as SIZE * SIZE hex exponents, row by row
+ * @param board Board to be written
+ * @param text Buffer of at least SIZE * SIZE + 1 characters
+ */
+void
+formatBoard(uint8_t board[SIZE][SIZE], char *text) {
+	static const char digits[] = "0123456789abcdef";
+	int i, j;
+
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j++) {
+			*text ++ = digits[board[i][j] & 0xf];
+		}
+	}
+	*text = '\0';
+}
+
+/** Load a corpus file, it starts with CORPUS_HEADER and other lines 
+ * starting with # are comments
+ * @param corpus Empty corpus to be filled
+ * @param path File to be read
+ * @return bool False if the file can not be read, is not a corpus of 
+ * CORPUS_VERSION or has a bad line
+ */
+bool
+loadCorpus(corpus_t *corpus, const char *path) {
+	char line[MAX_LINE];
+	uint8_t board[SIZE][SIZE];
+	int version = 0;
+
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		return false;
+	}
+
+	// Checksums of another version are not comparable
+	if (fgets(line, MAX_LINE, fp) == NULL || 
+		sscanf(line, CORPUS_HEADER, &version) != 1 || 
+		version != CORPUS_VERSION) {
+		fprintf(stderr, "%s is not a v%d corpus\n", path, CORPUS_VERSION);
+		fclose(fp);
+		return false;
+	}
+
+	while (fgets(line, MAX_LINE, fp) != NULL) {
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+		if (!parseBoard(line, board)) {
+			fclose(fp);
+			return false;
+		}
+		insertIntoCorpus(corpus, board, line[SIZE * SIZE] == ' ' ? 
+			line[SIZE * SIZE + 1] : '?');
+	}
+
+	fclose(fp);
+	return true;
+}
+
+/** Save a corpus file, one board and its stage per line
+ * @param corpus Corpus to be saved
+ * @param path File to be written
+ */
+void
+saveCorpus(corpus_t *corpus, const char *path) {
+	char text[SIZE * SIZE + 1];
+	int i;
+
+	/** File open */
+	FILE *fp = fopen(path, "w");
+	assert(fp != NULL);
+
+	fprintf(fp, CORPUS_HEADER "\n", CORPUS_VERSION);
+	fprintf(fp, "# board: %d hex tile exponents row by row, stage: "
+		"e(arly) m(id) l(ate)\n", SIZE * SIZE);
+	for (i = 0; i < corpus -> n; i ++) {
+		formatBoard(corpus -> boards[i], text);
+		fprintf(fp, "%s %c\n", text, corpus -> stage[i]);
+	}
+
+	fclose(fp);
+}
+
+/****************************GENERATE*FUNCTION*******************************/
+
+/** Gather positions from seeded self play at CORPUS_DEPTH, every 
+ * CORPUS_STRIDE moves, until each stage has perStage positions
+ * @param corpus Empty corpus to be filled
+ * @param perStage Number of positions of every stage
+ * @param seed Seed of the spawns and of the tie break
+ */
+void
+generateCorpus(corpus_t *corpus, int perStage, uint32_t seed) {
+	static const char stages[CORPUS_STAGES] = {'e', 'm', 'l'};
+	int count[CORPUS_STAGES] = {0};
+	uint8_t board[SIZE][SIZE];
+	uint32_t score;
+	int generated = 0, expanded = 0, pruned = 0;
+	int step, stage;
+
+	srand(seed);
+	while (count[0] < perStage || count[1] < perStage || 
+		count[2] < perStage) {
+		// New game with seeded spawns
+		memset(board, 0, sizeof(board));
+		addRandomSeeded(board, &seed);
+		addRandomSeeded(board, &seed);
+		score = 0;
+		step = 0;
+
+		while (!gameEnded(board)) {
+			uint8_t tile = maximumTile(board);
+			stage = tile <= EARLY_MAX_TILE ? 0 : tile <= MID_MAX_TILE ? 1 : 2;
+			if (++ step % CORPUS_STRIDE == 0 && count[stage] < perStage) {
+				insertIntoCorpus(corpus, board, stages[stage]);
+				count[stage] ++;
+			}
+
+			move_t move = get_next_move(board, CORPUS_DEPTH, max, &generated, 
+				&expanded, &pruned);
+			if (execute_move_t(board, &score, move)) {
+				addRandomSeeded(board, &seed);
+			}
+		}
+	}
+}
@@ -0,0 +1,53 @@
+/*
+ ============================================================================
+ Name        : corpus.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Versioned corpus of positions used as fixed search workload
+ ============================================================================
+ */
+
+#ifndef __CORPUS__
+#define __CORPUS__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+#define CORPUS_VERSION 1
+#define CORPUS_HEADER "# 2048 position corpus v%d"
+#define CORPUS_STAGES 3 // early, mid and late game
+#define CORPUS_PER_STAGE 1000
+#define CORPUS_SEED 2048u
+#define CORPUS_DEPTH 3 // depth of the self play that gathers positions
+#define CORPUS_STRIDE 5 // moves played between two gathered positions
+#define EARLY_MAX_TILE 7 // exponent, early game has no tile above 128
+#define MID_MAX_TILE 9 // exponent, mid game has no tile above 512
+#define MAX_LINE 256
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Positions of a corpus, stage is 'e', 'm' or 'l'
+ */
+typedef struct corpus_s {
+	uint8_t (*boards)[SIZE][SIZE];
+	char *stage;
+	int n;
+	int size;
+} corpus_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+void initCorpus(corpus_t *corpus);
+void insertIntoCorpus(corpus_t *corpus, uint8_t board[SIZE][SIZE], 
+	char stage);
+bool loadCorpus(corpus_t *corpus, const char *path);
+void saveCorpus(corpus_t *corpus, const char *path);
+void generateCorpus(corpus_t *corpus, int perStage, uint32_t seed);
+void freeCorpus(corpus_t *corpus);
+
+bool parseBoard(const char *text, uint8_t board[SIZE][SIZE]);
+void formatBoard(uint8_t board[SIZE][SIZE], char *text);
+
+#endif
@@ -0,0 +1,276 @@
+/*
+ ============================================================================
+ Name        : kernel.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Search kernels specialised at compile time for every depth
+ ============================================================================
+ */
+
+#include <assert.h>
+
+#include "kernel.h"
+#include "trace.h"
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Counters of one kernel search, best is the greatest priority of every
+ * node built so far, the value the best root move reaches at least
+ */
+typedef struct kernelState_s {
+	weights_t weights;
+	uint32_t best;
+	int generated;
+	int expanded;
+	int pruned;
+} kernelState_t;
+
+/**
+ * Walk of the levels below a root move
+ */
+typedef uint32_t (*maxLevel_t)(kernelState_t *state, node_t *node);
+
+/*****************************LEVEL*FUNCTION*********************************/
+
+/** Build every legal child of a node on the stack of the caller with 
+ * successorNodes, same board, spawn and priority as generateChild
+ * @param state Counters of the search
+ * @param node Parent of the children
+ * @param child Child of every legal move, indexed by move
+ * @return mask Bit m set if move m is legal
+ */
+static inline uint8_t
+buildChildren(kernelState_t *state, node_t *node, 
+	node_t child[NUMBER_OF_MOVES]) {
+	uint32_t gains[NUMBER_OF_MOVES];
+	TRACE_BEGIN(successors);
+	uint8_t mask = successorNodes(node, child, gains, &state -> weights);
+	int move;
+
+	for (move = left; move <= down; move ++) {
+		if (!(mask >> move & 1)) {
+			continue;
+		}
+
+		uint32_t seed = hashBoard(child[move].board);
+		spawnLines(&child[move], &seed, &state -> weights);
+
+		child[move].priority = node -> priority +
+			state -> weights.weight[WEIGHT_SCORE] * gains[move] +
+			state -> weights.weight[WEIGHT_EMPTY] * 
+			countEmptyLines(&child[move]) +
+			state -> weights.weight[WEIGHT_MONOTONIC] * 
+			countMonotonicLines(&child[move]);
+		child[move].move = move;
+		state -> generated ++;
+		state -> expanded ++;
+
+		if (child[move].priority > state -> best) {
+			state -> best = child[move].priority;
+		}
+	}
+	TRACE_END(successors, "buildChildren", TRACE_NO_ARG);
+
+	return mask;
+}
+
+/** Order children by decreasing priority, insertion sort of an index
+ * @param child Children of a node
+ * @param order Index of the n children in child, sorted
+ * @param n Number of children
+ */
+static inline void
+sortChildren(node_t child[NUMBER_OF_MOVES], int order[NUMBER_OF_MOVES], int n) {
+	int i, k, index;
+
+	for (i = 1; i < n; i ++) {
+		index = order[i];
+		for (k = i; k > 0 && child[order[k - 1]].priority <
+			child[index].priority; k --) {
+			order[k] = order[k - 1];
+		}
+		order[k] = index;
+	}
+}
+
+/** Leaf of a max search, nothing below it
+ * @param state Counters of the search
+ * @param node Leaf
+ * @return priority Priority of the leaf
+ */
+static uint32_t
+maxLevel0(kernelState_t *state, node_t *node) {
+	return node -> priority;
+}
+
+/** Expand the root and walk the levels below every root move under max
+ * propagation. Values and ties are those of the generic engine, and ties 
+ * are broken in move order as getBestRandomIndex does. The nodes live on 
+ * the stack, one array of children per level, and are recorded as the 
+ * memory of the search
+ * @param board The condition of the current board
+ * @param depth Depth of the kernel
+ * @param maxLevel Walk below a root move
+ * @param values Value of every move, 0 if illegal (can be NULL)
+ * @param numberOfGeneratedNode Calculate total number of generated node
+ * @param numberOfExpandedNode Calculate total number of expanded node
+ * @param numberOfPrunedNode Calculate total number of pruned node
+ * @return best_action Move that lead to highest score, left if none legal
+ */
+static move_t
+searchKernel(uint8_t board[SIZE][SIZE], int depth, maxLevel_t maxLevel,
+	uint32_t values[NUMBER_OF_MOVES], int *numberOfGeneratedNode,
+	int *numberOfExpandedNode, int *numberOfPrunedNode) {
+	uint32_t value[NUMBER_OF_MOVES] = {0}, top = 0;
+	int ties[NUMBER_OF_MOVES], order[NUMBER_OF_MOVES], nTies = 0, n = 0, i;
+	node_t root, child[NUMBER_OF_MOVES];
+	kernelState_t state;
+	uint8_t mask;
+	move_t move;
+
+	state.weights = *searchWeights();
+	state.best = 0;
+	state.generated = state.pruned = 0;
+	state.expanded = 1; // the root
+
+	root.priority = INITIAL;
+	copyBoard(root.board, board);
+	initLines(&root);
+
+	mask = buildChildren(&state, &root, child);
+	for (move = left; move <= down; move ++) {
+		if (mask >> move & 1) {
+			order[n ++] = move;
+		}
+	}
+
+	// The most promising root move first, so it sets the bound of the others
+	sortChildren(child, order, n);
+
+	for (i = 0; i < n; i ++) {
+		node_t *decision = &child[order[i]];
+
+		TRACE_BEGIN(walk);
+		value[decision -> move] = maxLevel(&state, decision);
+		TRACE_END(walk, "maxLevel", decision -> move);
+
+		if (value[decision -> move] > top) {
+			top = value[decision -> move];
+		}
+	}
+
+	// Tie between the best moves is broken randomly, as bestAction
+	for (move = left; move <= down; move ++) {
+		if (mask >> move & 1 && value[move] == top) {
+			ties[nTies ++] = move;
+		}
+	}
+	if (values != NULL) {
+		memcpy(values, value, sizeof(value));
+	}
+
+	*numberOfGeneratedNode += state.generated;
+	*numberOfExpandedNode += state.expanded;
+	*numberOfPrunedNode += state.pruned;
+	recordSearch(sizeof(node_t) * (1 + NUMBER_OF_MOVES * depth));
+
+	return nTies ? ties[tieBreak(nTies)] : left;
+}
+
+/*****************************SPECIALISATION*********************************/
+
+#define KERNEL_DEPTH 1
+#define KERNEL_LOWER 0
+#include "kernel_engine.h"
+#undef KERNEL_DEPTH
+#undef KERNEL_LOWER
+
+#define KERNEL_DEPTH 2
+#define KERNEL_LOWER 1
+#include "kernel_engine.h"
+#undef KERNEL_DEPTH
+#undef KERNEL_LOWER
+
+#define KERNEL_DEPTH 3
+#define KERNEL_LOWER 2
+#include "kernel_engine.h"
+#undef KERNEL_DEPTH
+#undef KERNEL_LOWER
+
+#define KERNEL_DEPTH 4
+#define KERNEL_LOWER 3
+#include "kernel_engine.h"
+#undef KERNEL_DEPTH
+#undef KERNEL_LOWER
+
+#define KERNEL_DEPTH 5
+#define KERNEL_LOWER 4
+#include "kernel_engine.h"
+#undef KERNEL_DEPTH
+#undef KERNEL_LOWER
+
+#define KERNEL_DEPTH 6
+#define KERNEL_LOWER 5
+#include "kernel_engine.h"
+#undef KERNEL_DEPTH
+#undef KERNEL_LOWER
+
+#define KERNEL_DEPTH 7
+#define KERNEL_LOWER 6
+#include "kernel_engine.h"
+#undef KERNEL_DEPTH
+#undef KERNEL_LOWER
+
+/** Every generated kernel, other depths and avg use the generic engine */
+static const kernel_t kernels[] = {
+	{1, max, searchMax1}, {2, max, searchMax2}, {3, max, searchMax3},
+	{4, max, searchMax4}, {5, max, searchMax5}, {6, max, searchMax6},
+	{7, max, searchMax7},
+};
+
+/*****************************KERNEL*FUNCTION********************************/
+
+/** Kernel generated for a depth and propagation
+ * @param max_depth Maximum depth that will be expanded
+ * @param propagation Type of propagation, max or avg
+ * @return kernel Kernel of that search, NULL if it was not generated
+ */
+const kernel_t *
+findKernel(int max_depth, propagation_t propagation) {
+	size_t i;
+
+	for (i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i ++) {
+		if (kernels[i].depth == max_depth &&
+			kernels[i].propagation == propagation) {
+			return &kernels[i];
+		}
+	}
+
+	return NULL;
+}
+
+/** Best move from the kernel, or from the generic engine without one
+ * @param kernel Kernel found for max_depth and propagation, or NULL
+ * @param board The condition of the current board
+ * @param max_depth Maximum depth that will be expanded
+ * @param propagation Type of propagation, max or avg
+ * @param numberOfGeneratedNode Calculate total number of generated node
+ * @param numberOfExpandedNode Calculate total number of expanded node
+ * @param numberOfPrunedNode Calculate total number of pruned node (max only)
+ * @return best_action Move that lead to highest score
+ */
+move_t
+kernelMove(const kernel_t *kernel, uint8_t board[SIZE][SIZE],
+	int max_depth, propagation_t propagation, int *numberOfGeneratedNode,
+	int *numberOfExpandedNode, int *numberOfPrunedNode) {
+	if (kernel == NULL) {
+		return get_next_move(board, max_depth, propagation,
+			numberOfGeneratedNode, numberOfExpandedNode, numberOfPrunedNode);
+	}
+
+	assert(kernel -> depth == max_depth &&
+		kernel -> propagation == propagation);
+	return kernel -> searchMove(board, NULL, numberOfGeneratedNode,
+		numberOfExpandedNode, numberOfPrunedNode);
+}
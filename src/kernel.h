@@ -0,0 +1,45 @@
+/*
+ ============================================================================
+ Name        : kernel.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Search kernels specialised at compile time for every depth
+ ============================================================================
+ */
+
+#ifndef __KERNEL__
+#define __KERNEL__
+
+#include "ai.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * Depths generated from kernel_engine.h, deeper searches and depth 0 keep
+ * the generic engine
+ */
+#define KERNEL_MIN_DEPTH 1
+#define KERNEL_MAX_DEPTH 7
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Search of one depth and propagation, same arguments and counters as
+ * searchMove without the depth and propagation that are fixed
+ */
+typedef struct kernel_s {
+	int depth;
+	propagation_t propagation;
+	move_t (*searchMove)(uint8_t board[SIZE][SIZE],
+		uint32_t values[NUMBER_OF_MOVES], int *numberOfGeneratedNode,
+		int *numberOfExpandedNode, int *numberOfPrunedNode);
+} kernel_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+const kernel_t *findKernel(int max_depth, propagation_t propagation);
+move_t kernelMove(const kernel_t *kernel, uint8_t board[SIZE][SIZE],
+	int max_depth, propagation_t propagation, int *numberOfGeneratedNode,
+	int *numberOfExpandedNode, int *numberOfPrunedNode);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ ============================================================================
+ Name        : kernel_engine.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Kernel template, included by kernel.c once per depth
+ ============================================================================
+ */
+
+/**
+ * Included with KERNEL_DEPTH and KERNEL_LOWER (KERNEL_DEPTH - 1) defined,
+ * every function gets the number of levels below its node appended to its
+ * name (maxLevel3 walks 3 levels below its node). A level only calls the
+ * level below it, so the depth of every call is a constant and the whole
+ * tree walk is known at compile time. Children are built on the stack of
+ * their level with buildChildren, there is no heap and no parent pointer.
+ * searchMax of KERNEL_DEPTH starts from the root. There is no avg kernel,
+ * the generic engine keeps a running mean rounded down in the order of its
+ * heap, which a depth first walk can not reproduce
+ */
+
+#if !defined(KERNEL_DEPTH) || !defined(KERNEL_LOWER)
+#error "kernel_engine.h needs KERNEL_DEPTH and KERNEL_LOWER"
+#endif
+
+#define KERNEL_PASTE(name, depth) name ## depth
+#define KERNEL_EXPAND(name, depth) KERNEL_PASTE(name, depth)
+#define KERNEL_NAME(name) KERNEL_EXPAND(name, KERNEL_DEPTH)
+#define KERNEL_BELOW(name) KERNEL_EXPAND(name, KERNEL_LOWER)
+
+/* The deepest level is only walked by a search one level deeper, which is
+ * not generated
+ */
+#if KERNEL_DEPTH < KERNEL_MAX_DEPTH
+
+/** Greatest priority of a node and its subtree, the children are walked
+ * from the most promising so that the bound prunes early
+ * @param state Counters and best priority of the search
+ * @param node Node with KERNEL_DEPTH levels below it
+ * @return best Greatest priority of the subtree, exact unless it can not
+ * reach the best priority found so far
+ */
+static uint32_t
+KERNEL_NAME(maxLevel)(kernelState_t *state, node_t *node) {
+	node_t child[NUMBER_OF_MOVES];
+	int order[NUMBER_OF_MOVES], n = 0, i, move;
+	uint32_t best = node -> priority, value;
+	uint8_t mask;
+
+	/* Even the bound of the subtree can not beat the best node found so 
+	 * far, the KERNEL_DEPTH levels below node are all that remain. Like the
+	 * generic engine every legal child counts as pruned
+	 */
+	if (upperBound(node -> board, node -> priority, KERNEL_DEPTH,
+		&state -> weights) < state -> best) {
+		state -> pruned += __builtin_popcount(legalMoves(node -> board));
+		return best;
+	}
+
+	mask = buildChildren(state, node, child);
+	for (move = left; move <= down; move ++) {
+		if (mask >> move & 1) {
+			order[n ++] = move;
+		}
+	}
+
+	#if KERNEL_LOWER > 0
+	sortChildren(child, order, n);
+	#endif
+
+	for (i = 0; i < n; i ++) {
+		value = KERNEL_BELOW(maxLevel)(state, &child[order[i]]);
+		if (value > best) {
+			best = value;
+		}
+	}
+
+	return best;
+}
+
+#endif
+
+/** Search of depth KERNEL_DEPTH under max propagation
+ * @param board The condition of the current board
+ * @param values Value of every move, 0 if illegal (can be NULL)
+ * @param numberOfGeneratedNode Calculate total number of generated node
+ * @param numberOfExpandedNode Calculate total number of expanded node
+ * @param numberOfPrunedNode Calculate total number of pruned node
+ * @return best_action Move that lead to highest score, left if none legal
+ */
+static move_t
+KERNEL_NAME(searchMax)(uint8_t board[SIZE][SIZE],
+	uint32_t values[NUMBER_OF_MOVES], int *numberOfGeneratedNode,
+	int *numberOfExpandedNode, int *numberOfPrunedNode) {
+	return searchKernel(board, KERNEL_DEPTH, KERNEL_BELOW(maxLevel), values,
+		numberOfGeneratedNode, numberOfExpandedNode, numberOfPrunedNode);
+}
+
+#undef KERNEL_PASTE
+#undef KERNEL_EXPAND
+#undef KERNEL_NAME
+#undef KERNEL_BELOW
@@ -0,0 +1,488 @@
+/*
+ ============================================================================
+ Name        : lockstep.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Many self-play games advanced in lockstep on packed boards
+ ============================================================================
+ */
+
+#include <math.h>
+
+#include "lockstep.h"
+#include "ai.h"
+#include "metrics.h"
+#include "memory.h"
+
+/*****************************ROW*TABLES*************************************/
+
+/** Result and score of sliding every packed row towards its low cell (up on
+ * the rows, left on the transposed board) and towards its high cell, the 
+ * four tables share one large region (a single huge page when available),
+ * mapped for the whole run
+ */
+static uint16_t *rowLow, *rowHigh;
+static uint32_t *scoreLow, *scoreHigh;
+static bool tablesReady = false;
+
+/** Pack the 4 cells of a line into a row, cell 0 in the low bits
+ * @param line Cells of the row
+ * @return row Packed row, cells above 15 are kept at 15
+ */
+static uint16_t
+packRow(uint8_t line[SIZE]) {
+	uint16_t row = 0;
+	int j;
+
+	for (j = SIZE - 1; j >= 0; j --) {
+		row = row << NIBBLE_BITS | (line[j] > NIBBLE ? NIBBLE : line[j]);
+	}
+
+	return row;
+}
+
+/** Fill the row tables from slideArray, so the rules are those of 
+ * execute_move_t
+ */
+void
+initRowTables() {
+	uint8_t line[SIZE], reversed[SIZE];
+	int row, j;
+
+	if (tablesReady) {
+		return;
+	}
+
+	backing_t backing;
+	size_t bytes = PACKED_ROWS * (2 * sizeof(uint16_t) + 2 * sizeof(uint32_t));
+	bytes = bytes < HUGE_PAGE ? HUGE_PAGE : bytes;
+	scoreLow = (uint32_t *) allocLarge(&bytes, &backing);
+	scoreHigh = scoreLow + PACKED_ROWS;
+	rowLow = (uint16_t *) (scoreHigh + PACKED_ROWS);
+	rowHigh = rowLow + PACKED_ROWS;
+
+	for (row = 0; row < PACKED_ROWS; row ++) {
+		for (j = 0; j < SIZE; j ++) {
+			line[j] = row >> (j * NIBBLE_BITS) & NIBBLE;
+			reversed[SIZE - 1 - j] = line[j];
+		}
+
+		scoreLow[row] = 0;
+		slideArray(line, &scoreLow[row]);
+		rowLow[row] = packRow(line);
+
+		scoreHigh[row] = 0;
+		slideArray(reversed, &scoreHigh[row]);
+		for (j = 0; j < SIZE; j ++) {
+			line[j] = reversed[SIZE - 1 - j];
+		}
+		rowHigh[row] = packRow(line);
+	}
+
+	tablesReady = true;
+}
+
+/*****************************PACKED*FUNCTION********************************/
+
+/** Transpose the packed board, cell (i, j) goes to (j, i)
+ * @param board Packed board
+ * @return transposed Packed transposed board
+ */
+uint64_t
+transposePacked(uint64_t board) {
+	uint64_t a1 = board & 0xF0F00F0FF0F00F0FULL;
+	uint64_t a2 = board & 0x0000F0F00000F0F0ULL;
+	uint64_t a3 = board & 0x0F0F00000F0F0000ULL;
+	uint64_t a = a1 | (a2 << 12) | (a3 >> 12);
+	uint64_t b1 = a & 0xFF00FF0000FF00FFULL;
+	uint64_t b2 = a & 0x00FF00FF00000000ULL;
+	uint64_t b3 = a & 0x00000000FF00FF00ULL;
+	return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+/** Packed counterpart of execute_move_t, one table lookup per row
+ * @param board Packed board
+ * @param move Move to be applied
+ * @param score Score increased by every merge
+ * @return moved Packed board after the move, equal to board if invalid
+ */
+uint64_t
+executePacked(uint64_t board, move_t move, uint32_t *score) {
+	bool transposed = move == left || move == right;
+	const uint16_t *table = move == up || move == left ? rowLow : rowHigh;
+	const uint32_t *scores = move == up || move == left ? scoreLow : scoreHigh;
+	uint64_t source = transposed ? transposePacked(board) : board;
+	uint64_t moved = 0;
+	int i;
+
+	for (i = 0; i < SIZE; i ++) {
+		uint64_t row = source >> (i * PACKED_ROW_BITS) & PACKED_ROW_MASK;
+		moved |= (uint64_t) table[row] << (i * PACKED_ROW_BITS);
+		*score += scores[row];
+	}
+
+	return transposed ? transposePacked(moved) : moved;
+}
+
+/** Number of empty cells, counted on all cells at once
+ * @param board Packed board
+ * @return count Empty cells
+ */
+int
+countEmptyPacked(uint64_t board) {
+	uint64_t occupied = board | board >> 1;
+	occupied |= occupied >> 2;
+	return PACKED_CELLS - __builtin_popcountll(occupied & LOWEST_BITS);
+}
+
+/** Packed counterpart of gameEnded, equal neighbours xor to an empty cell
+ * @param board Packed board
+ * @return bool True if no move is possible
+ */
+bool
+gameEndedPacked(uint64_t board) {
+	uint64_t row = board ^ board >> NIBBLE_BITS;
+	uint64_t column = board ^ board >> PACKED_ROW_BITS;
+
+	if (countEmptyPacked(board) > 0) {
+		return false;
+	}
+
+	// Lowest bit of every cell set when the cell differs from its neighbour
+	row |= row >> 1;
+	row |= row >> 2;
+	column |= column >> 1;
+	column |= column >> 2;
+
+	return (~row & PAIR_IN_ROW) == 0 && (~column & PAIR_IN_COLUMN) == 0;
+}
+
+/** Packed counterpart of addRandomSeeded, same draws from the same state
+ * @param board Packed board
+ * @param state Xorshift state
+ * @return board Packed board with the new tile
+ */
+uint64_t
+addRandomPacked(uint64_t board, uint32_t *state) {
+	int len = countEmptyPacked(board), k, r;
+
+	if (*state == 0) {
+		*state = 1;
+	}
+	if (len == 0) {
+		return board;
+	}
+
+	r = nextRandom(state) % len;
+	uint64_t tile = (nextRandom(state) % 10) / 9 + 1;
+
+	for (k = 0; k < PACKED_CELLS; k ++) {
+		if ((board >> (k * NIBBLE_BITS) & NIBBLE) == 0 && r -- == 0) {
+			return board | tile << (k * NIBBLE_BITS);
+		}
+	}
+
+	return board;
+}
+
+/** Largest tile of the packed board
+ * @param board Packed board
+ * @return tile Exponent of the largest tile
+ */
+static uint8_t
+maximumPacked(uint64_t board) {
+	uint8_t tile = 0;
+	int k;
+
+	for (k = 0; k < PACKED_CELLS; k ++) {
+		uint8_t cell = board >> (k * NIBBLE_BITS) & NIBBLE;
+		tile = cell > tile ? cell : tile;
+	}
+
+	return tile;
+}
+
+/*****************************LOCKSTEP*FUNCTION******************************/
+
+/** Seed of the spawns of a game, so a game does not depend on its lane
+ * @param seed Seed of the whole run
+ * @param game Index of the game
+ * @return state Non zero xorshift state
+ */
+uint32_t
+gameSeed(uint32_t seed, int game) {
+	uint32_t state = (seed ^ 2166136261u) * 16777619u;
+	state = (state ^ (uint32_t) game) * 16777619u;
+	return state ? state : 1;
+}
+
+/** Start the next game on a lane, or park the lane if none is left
+ * @param lockstep Engine
+ * @param lane Lane to be refilled
+ */
+static void
+refillLane(lockstep_t *lockstep, int lane) {
+	if (lockstep -> nextGame == lockstep -> games) {
+		lockstep -> game[lane] = -1;
+		lockstep -> boards[lane] = 0;
+		return;
+	}
+
+	int game = lockstep -> nextGame ++;
+	uint32_t state = gameSeed(lockstep -> seed, game);
+	uint64_t board = addRandomPacked(0, &state);
+
+	lockstep -> boards[lane] = addRandomPacked(board, &state);
+	lockstep -> rng[lane] = state;
+	lockstep -> scores[lane] = 0;
+	lockstep -> turns[lane] = 0;
+	lockstep -> game[lane] = game;
+}
+
+/** Allocate the lanes and start the first games
+ * @param lockstep Engine to be initialised
+ * @param lanes Games in flight
+ * @param games Games to be played
+ * @param seed Seed of the run
+ */
+void
+initLockstep(lockstep_t *lockstep, int lanes, int games, uint32_t seed) {
+	int lane;
+
+	initRowTables();
+
+	lockstep -> lanes = lanes;
+	lockstep -> games = games;
+	lockstep -> nextGame = 0;
+	lockstep -> finished = 0;
+	lockstep -> seed = seed;
+	lockstep -> boards = (uint64_t *) malloc(sizeof(uint64_t) * lanes);
+	lockstep -> scores = (uint32_t *) malloc(sizeof(uint32_t) * lanes);
+	lockstep -> rng = (uint32_t *) malloc(sizeof(uint32_t) * lanes);
+	lockstep -> turns = (uint32_t *) malloc(sizeof(uint32_t) * lanes);
+	lockstep -> game = (int *) malloc(sizeof(int) * lanes);
+	lockstep -> results = (game_t *) malloc(sizeof(game_t) * games);
+	assert(lockstep -> boards != NULL && lockstep -> scores != NULL && 
+		lockstep -> rng != NULL && lockstep -> turns != NULL && 
+		lockstep -> game != NULL && lockstep -> results != NULL);
+
+	for (lane = 0; lane < lanes; lane ++) {
+		refillLane(lockstep, lane);
+	}
+}
+
+/** Advance every lane by one turn, the depth 1 greedy policy (score plus 
+ * empty cells, first move on ties) is applied to every lane, then the 
+ * spawns, then the game over check, finished lanes are refilled
+ * @param lockstep Engine
+ */
+void
+stepLockstep(lockstep_t *lockstep) {
+	uint64_t *boards = lockstep -> boards;
+	uint32_t *scores = lockstep -> scores;
+	int lanes = lockstep -> lanes;
+	int lane, move;
+
+	// Policy and move, every move of every lane from the row tables
+	for (lane = 0; lane < lanes; lane ++) {
+		uint64_t best = boards[lane];
+		uint32_t bestGain = 0, bestValue = 0;
+
+		for (move = left; move < NUMBER_OF_MOVES; move ++) {
+			uint32_t gain = 0;
+			uint64_t moved = executePacked(boards[lane], move, &gain);
+			uint32_t value = gain + countEmptyPacked(moved);
+			bool better = moved != boards[lane] && 
+				(best == boards[lane] || value > bestValue);
+			best = better ? moved : best;
+			bestGain = better ? gain : bestGain;
+			bestValue = better ? value : bestValue;
+		}
+
+		boards[lane] = best;
+		scores[lane] += bestGain;
+	}
+
+	// Spawns, every parked lane has an empty board and stays empty
+	for (lane = 0; lane < lanes; lane ++) {
+		if (lockstep -> game[lane] >= 0) {
+			boards[lane] = addRandomPacked(boards[lane], &lockstep -> rng[lane]);
+			lockstep -> turns[lane] ++;
+		}
+	}
+
+	// Game over mask, finished lanes are recorded and refilled
+	for (lane = 0; lane < lanes; lane ++) {
+		if (lockstep -> game[lane] >= 0 && gameEndedPacked(boards[lane])) {
+			game_t *result = &lockstep -> results[lockstep -> game[lane]];
+			result -> score = scores[lane];
+			result -> turns = lockstep -> turns[lane];
+			result -> maxTile = maximumPacked(boards[lane]);
+			lockstep -> finished ++;
+			refillLane(lockstep, lane);
+		}
+	}
+}
+
+/** Step until every game is finished
+ * @param lockstep Engine
+ */
+void
+runLockstep(lockstep_t *lockstep) {
+	while (lockstep -> finished < lockstep -> games) {
+		stepLockstep(lockstep);
+	}
+}
+
+/** Free the lanes and the results
+ * @param lockstep Engine
+ */
+void
+freeLockstep(lockstep_t *lockstep) {
+	free(lockstep -> boards);
+	free(lockstep -> scores);
+	free(lockstep -> rng);
+	free(lockstep -> turns);
+	free(lockstep -> game);
+	free(lockstep -> results);
+}
+
+/** Same game as a lockstep lane, one board at a time with execute_move_t,
+ * reference of the packed kernels and scalar baseline of the benchmark
+ * @param seed Seed of the run
+ * @param game Index of the game
+ * @param result Outcome of the game
+ */
+void
+playGreedy(uint32_t seed, int game, game_t *result) {
+	uint8_t board[SIZE][SIZE], moved[SIZE][SIZE], best[SIZE][SIZE];
+	uint32_t state = gameSeed(seed, game);
+	int move;
+
+	memset(board, 0, sizeof(board));
+	addRandomSeeded(board, &state);
+	addRandomSeeded(board, &state);
+	result -> score = 0;
+	result -> turns = 0;
+
+	do {
+		uint32_t bestGain = 0, bestValue = 0;
+		bool found = false;
+
+		for (move = left; move < NUMBER_OF_MOVES; move ++) {
+			uint32_t gain = 0;
+			copyBoard(moved, board);
+			if (!execute_move_t(moved, &gain, move)) {
+				continue;
+			}
+			uint32_t value = gain + countEmpty(moved);
+			if (!found || value > bestValue) {
+				copyBoard(best, moved);
+				bestGain = gain;
+				bestValue = value;
+				found = true;
+			}
+		}
+
+		copyBoard(board, best);
+		result -> score += bestGain;
+		result -> turns ++;
+		addRandomSeeded(board, &state);
+	} while (!gameEnded(board));
+
+	result -> maxTile = maximumTile(board);
+}
+
+/*****************************SELF*PLAY*FUNCTION*****************************/
+
+/** ./2048 selfplay <games> [--lanes n] [--seed n] [--out file] [--check],
+ * plays every game in lockstep and prints the throughput and scores, 
+ * --check replays every game with playGreedy and compares them
+ * @param argc Number of arguments
+ * @param argv Arguments, argv[1] is selfplay
+ * @return int Exit status
+ */
+int
+selfPlay(int argc, char *argv[]) {
+	int lanes = LOCKSTEP_LANES, games = 0, i, mismatches = 0;
+	int tiles[NIBBLE + 1] = {0};
+	uint32_t seed = time(NULL);
+	uint64_t turns = 0, total = 0;
+	char *outPath = NULL;
+	bool check = false;
+	lockstep_t lockstep;
+
+	sscanf(argv[2], "%d", &games);
+	for (i = 3; i < argc; i ++) {
+		if (strcmp(argv[i], "--lanes") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &lanes);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%u", &seed);
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			outPath = argv[++ i];
+		}
+		else if (strcmp(argv[i], "--check") == 0) {
+			check = true;
+		}
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (games < 1 || lanes < 1) {
+		fprintf(stderr, "games and lanes must be positive\n");
+		return EXIT_FAILURE;
+	}
+
+	initLockstep(&lockstep, lanes, games, seed);
+	double start = wallClock();
+	runLockstep(&lockstep);
+	double end = wallClock();
+
+	for (i = 0; i < games; i ++) {
+		turns += lockstep.results[i].turns;
+		total += lockstep.results[i].score;
+		tiles[lockstep.results[i].maxTile] ++;
+	}
+	printf("%d games, %d lanes, seed %u: %.3f s, %.0f games/s, %.0f moves/s,"
+		" mean score %.1f\n", games, lanes, seed, end - start, 
+		games / (end - start), turns / (end - start), (double) total / games);
+	for (i = 0; i <= NIBBLE; i ++) {
+		if (tiles[i]) {
+			printf("  max tile %6d: %d\n", (int) pow(BASE, i), tiles[i]);
+		}
+	}
+
+	if (outPath != NULL) {
+		FILE *fp = fopen(outPath, "w");
+		if (fp == NULL) {
+			fprintf(stderr, "can not write %s\n", outPath);
+			freeLockstep(&lockstep);
+			return EXIT_FAILURE;
+		}
+		fprintf(fp, "game,score,turns,max_tile\n");
+		for (i = 0; i < games; i ++) {
+			fprintf(fp, "%d,%u,%u,%d\n", i, lockstep.results[i].score, 
+				lockstep.results[i].turns, 
+				(int) pow(BASE, lockstep.results[i].maxTile));
+		}
+		fclose(fp);
+	}
+
+	if (check) {
+		for (i = 0; i < games; i ++) {
+			game_t reference;
+			playGreedy(seed, i, &reference);
+			mismatches += reference.score != lockstep.results[i].score || 
+				reference.turns != lockstep.results[i].turns || 
+				reference.maxTile != lockstep.results[i].maxTile;
+		}
+		printf("check: %d of %d games differ from playGreedy\n", mismatches, 
+			games);
+	}
+
+	freeLockstep(&lockstep);
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
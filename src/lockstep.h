@@ -0,0 +1,75 @@
+/*
+ ============================================================================
+ Name        : lockstep.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Many self-play games advanced in lockstep on packed boards
+ ============================================================================
+ */
+
+#ifndef __LOCKSTEP__
+#define __LOCKSTEP__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+#define PACKED_ROW_BITS 16
+#define PACKED_ROWS 65536 // every packed row, 4 cells of 4 bits
+#define PACKED_ROW_MASK 0xffffULL
+#define PACKED_CELLS (SIZE * SIZE)
+#define LOWEST_BITS 0x1111111111111111ULL // lowest bit of every cell
+#define PAIR_IN_ROW 0x0111011101110111ULL // cells with a right neighbour
+#define PAIR_IN_COLUMN 0x0000111111111111ULL // cells with a lower neighbour
+#define LOCKSTEP_LANES 64 // games in flight by default
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Outcome of one finished game
+ */
+typedef struct game_s {
+	uint32_t score;
+	uint32_t turns;
+	uint8_t maxTile;
+} game_t;
+
+/**
+ * Games in flight, structure of arrays with one lane per game. Boards are
+ * packed as packBoard (cell board[i][j] in bits 4 * (i * SIZE + j)) so 
+ * tiles stop at 2^15 (NIBBLE). Finished lanes are refilled with the next game
+ */
+typedef struct lockstep_s {
+	int lanes;
+	uint64_t *boards;
+	uint32_t *scores;
+	uint32_t *rng; // xorshift state of the spawns of every lane
+	uint32_t *turns;
+	int *game; // game played by the lane, -1 once no game is left
+	int nextGame;
+	int games; // games to be played
+	int finished;
+	uint32_t seed;
+	game_t *results; // indexed by game, independent of the lanes
+} lockstep_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+/** Packed board kernels */
+void initRowTables();
+uint64_t transposePacked(uint64_t board);
+uint64_t executePacked(uint64_t board, move_t move, uint32_t *score);
+int countEmptyPacked(uint64_t board);
+bool gameEndedPacked(uint64_t board);
+uint64_t addRandomPacked(uint64_t board, uint32_t *state);
+
+/** Lockstep engine */
+void initLockstep(lockstep_t *lockstep, int lanes, int games, uint32_t seed);
+void stepLockstep(lockstep_t *lockstep);
+void runLockstep(lockstep_t *lockstep);
+void freeLockstep(lockstep_t *lockstep);
+uint32_t gameSeed(uint32_t seed, int game);
+void playGreedy(uint32_t seed, int game, game_t *result);
+int selfPlay(int argc, char *argv[]);
+
+#endif
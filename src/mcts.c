@@ -0,0 +1,454 @@
+/*
+ ============================================================================
+ Name        : mcts.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Monte Carlo tree search with parallel rollouts
+ ============================================================================
+ */
+
+#include "mcts.h"
+#include "ai.h"
+#include "lockstep.h"
+#include "metrics.h"
+
+/*****************************TREE*FUNCTION**********************************/
+
+/** Allocate a node of the tree from the arena, NULL once the tree has
+ * reached the memory limit
+ * @param search Search holding the tree
+ * @param parent Parent of the node, NULL for the root
+ * @param board Packed board of the node
+ * @param chance True for a chance node
+ * @return node New node, linked as first child of parent
+ */
+static mcts_node_t
+*newNode(mcts_t *search, mcts_node_t *parent, uint64_t board, bool chance) {
+	if (search -> memoryLimit && parent != NULL &&
+		search -> nodes.reserved + arenaNextChunk(&search -> nodes,
+		sizeof(mcts_node_t)) > search -> memoryLimit) {
+		search -> degraded = true;
+		return NULL;
+	}
+
+	mcts_node_t *node = (mcts_node_t *) arenaAlloc(&search -> nodes,
+		sizeof(mcts_node_t));
+	assert(node != NULL);
+
+	node -> board = board;
+	node -> reward = 0;
+	node -> visits = 0;
+	node -> virtualLoss = 0;
+	node -> gain = 0;
+	node -> move = left;
+	node -> chance = chance;
+	node -> expanded = false;
+	node -> parent = parent;
+	node -> child = NULL;
+	node -> sibling = NULL;
+	if (parent != NULL) {
+		node -> sibling = parent -> child;
+		parent -> child = node;
+	}
+	search -> generated ++;
+
+	return node;
+}
+
+/** Create one chance child per legal move of a decision node
+ * @param search Search holding the tree
+ * @param node Decision node, without children
+ * @return bool False if the tree is full, the node is then left as a leaf
+ */
+static bool
+expandNode(mcts_t *search, mcts_node_t *node) {
+	int move;
+
+	for (move = NUMBER_OF_MOVES - 1; move >= 0; move --) {
+		uint32_t gain = 0;
+		uint64_t moved = executePacked(node -> board, move, &gain);
+		if (moved == node -> board) {
+			continue;
+		}
+
+		mcts_node_t *child = newNode(search, node, moved, true);
+		if (child == NULL) {
+			node -> child = NULL;
+			return false;
+		}
+		child -> gain = gain;
+		child -> move = move;
+	}
+
+	node -> expanded = true;
+	return true;
+}
+
+/** Child of a decision node with the best upper confidence bound, children
+ * that were never visited come first, rollouts in flight count as visits
+ * without reward so the other threads spread over the tree
+ * @param search Search holding the tree
+ * @param node Expanded decision node with at least one child
+ * @return child Chance child to be followed
+ */
+static mcts_node_t
+*selectChild(mcts_t *search, mcts_node_t *node) {
+	double total = node -> visits + node -> virtualLoss, best = -1;
+	double logTotal = log(total < 1 ? 1 : total);
+	mcts_node_t *child, *selected = node -> child;
+
+	for (child = node -> child; child != NULL; child = child -> sibling) {
+		int n = child -> visits + child -> virtualLoss;
+		if (n == 0) {
+			return child;
+		}
+
+		double value = child -> reward / n / search -> scale +
+			MCTS_EXPLORATION * sqrt(logTotal / n);
+		if (value > best) {
+			best = value;
+			selected = child;
+		}
+	}
+
+	return selected;
+}
+
+/** Descend from the root to the node where the rollout starts, adding a
+ * virtual loss to every node of the path, the caller holds the lock
+ * @param search Search holding the tree
+ * @param state Random state of the thread, draws the spawns
+ * @param leaf Board the rollout starts from
+ * @param gain Score of the moves of the path
+ * @return node Deepest node of the path, the reward is backed up from it
+ */
+static mcts_node_t
+*selectPath(mcts_t *search, uint32_t *state, uint64_t *leaf, uint32_t *gain) {
+	mcts_node_t *node = search -> root;
+
+	*gain = 0;
+	node -> virtualLoss ++;
+	while (true) {
+		if (!node -> chance) {
+			*leaf = node -> board;
+
+			// First visit of a decision node is a rollout
+			if (!node -> expanded && (node -> visits == 0 ||
+				!expandNode(search, node))) {
+				break;
+			}
+
+			// No legal move, the game is over
+			if (node -> child == NULL) {
+				break;
+			}
+
+			node = selectChild(search, node);
+			*gain += node -> gain;
+		}
+		else {
+			// Spawns are drawn, every outcome drawn so far has its child
+			uint64_t spawned = addRandomPacked(node -> board, state);
+			mcts_node_t *child = node -> child;
+			while (child != NULL && child -> board != spawned) {
+				child = child -> sibling;
+			}
+
+			*leaf = spawned;
+			if (child == NULL &&
+				(child = newNode(search, node, spawned, false)) == NULL) {
+				break;
+			}
+			node = child;
+		}
+
+		node -> virtualLoss ++;
+	}
+
+	return node;
+}
+
+/** Back up the reward from the node to the root, removing the virtual loss
+ * of the path, the caller holds the lock
+ * @param search Search holding the tree
+ * @param node Deepest node of the path
+ * @param reward Score of the path and of the rollout
+ */
+static void
+backupPath(mcts_t *search, mcts_node_t *node, double reward) {
+	if (reward > search -> scale) {
+		search -> scale = reward;
+	}
+
+	for (; node != NULL; node = node -> parent) {
+		node -> virtualLoss --;
+		node -> visits ++;
+		node -> reward += reward;
+	}
+}
+
+/*****************************ROLLOUT*FUNCTION*******************************/
+
+/** Random legal move, the moves are tried from a random one
+ * @param board Packed board, not over
+ * @param gain Score increased by the move
+ * @param state Random state of the thread
+ * @return moved Board after the move
+ */
+static uint64_t
+randomMove(uint64_t board, uint32_t *gain, uint32_t *state) {
+	int first = nextRandom(state) % NUMBER_OF_MOVES, k;
+
+	for (k = 0; k < NUMBER_OF_MOVES; k ++) {
+		uint32_t score = 0;
+		uint64_t moved = executePacked(board, (first + k) % NUMBER_OF_MOVES,
+			&score);
+		if (moved != board) {
+			*gain += score;
+			return moved;
+		}
+	}
+
+	return board;
+}
+
+/** Move with the highest score plus empty cells, first move on ties
+ * @param board Packed board, not over
+ * @param gain Score increased by the move
+ * @return moved Board after the move
+ */
+static uint64_t
+greedyMove(uint64_t board, uint32_t *gain) {
+	uint64_t best = board;
+	uint32_t bestGain = 0, bestValue = 0;
+	int move;
+
+	for (move = 0; move < NUMBER_OF_MOVES; move ++) {
+		uint32_t score = 0;
+		uint64_t moved = executePacked(board, move, &score);
+		uint32_t value = score + countEmptyPacked(moved);
+		if (moved != board && (best == board || value > bestValue)) {
+			best = moved;
+			bestGain = score;
+			bestValue = value;
+		}
+	}
+
+	*gain += bestGain;
+	return best;
+}
+
+/** Play the board to the end of the game
+ * @param board Packed board after its spawn
+ * @param rollout Policy of the moves
+ * @param state Random state of the thread, draws the spawns
+ * @return gain Score of the game from the board
+ */
+static uint32_t
+rolloutBoard(uint64_t board, rollout_t rollout, uint32_t *state) {
+	uint32_t gain = 0;
+
+	while (!gameEndedPacked(board)) {
+		board = rollout == ROLLOUT_GREEDY ? greedyMove(board, &gain) :
+			randomMove(board, &gain, state);
+		board = addRandomPacked(board, state);
+	}
+
+	return gain;
+}
+
+/*****************************WORKER*FUNCTION********************************/
+
+/** Whether another rollout can be started, the caller holds the lock
+ * @param search Search holding the tree
+ * @return bool True while the budget of the move is not spent
+ */
+static bool
+hasBudget(mcts_t *search) {
+	if (search -> iterations > 0) {
+		return search -> started < search -> iterations;
+	}
+	return wallClock() < search -> deadline;
+}
+
+/** Worker of the pool, runs rollouts until the budget of every move is
+ * spent, only selection and backup hold the lock
+ * @param arg Search shared with the other workers
+ */
+static void
+*mctsWorker(void *arg) {
+	mcts_t *search = (mcts_t *) arg;
+	uint32_t state, gain;
+	uint64_t leaf;
+	int thread;
+
+	// Index of the worker, only used for its random state
+	thread = __atomic_fetch_add(&search -> nextThread, 1, __ATOMIC_RELAXED);
+
+	while (true) {
+		pthread_barrier_wait(&search -> start);
+		if (search -> done) {
+			break;
+		}
+
+		state = gameSeed(search -> seed ^ search -> moves, thread);
+		pthread_mutex_lock(&search -> lock);
+		while (hasBudget(search)) {
+			search -> started ++;
+			mcts_node_t *node = selectPath(search, &state, &leaf, &gain);
+			pthread_mutex_unlock(&search -> lock);
+
+			double reward = gain + rolloutBoard(leaf, search -> rollout,
+				&state);
+
+			pthread_mutex_lock(&search -> lock);
+			backupPath(search, node, reward);
+			search -> finished ++;
+		}
+		pthread_mutex_unlock(&search -> lock);
+
+		pthread_barrier_wait(&search -> finish);
+	}
+
+	return NULL;
+}
+
+/*****************************SEARCH*FUNCTION********************************/
+
+/** Parse the budget of a move, a number of rollouts or a time in s or ms
+ * @param text Budget such as 10000, 0.5s or 200ms
+ * @param iterations Rollouts per move, 0 if the budget is a time
+ * @param seconds Time per move, 0 if the budget is rollouts
+ * @return bool False if text is not a budget
+ */
+bool
+parseBudget(const char *text, int *iterations, double *seconds) {
+	char *end;
+	double value = strtod(text, &end);
+
+	*iterations = 0;
+	*seconds = 0;
+	if (end == text || value <= 0) {
+		return false;
+	}
+
+	if (strcmp(end, "ms") == 0) {
+		*seconds = value / MILLISECOND;
+	}
+	else if (strcmp(end, "s") == 0) {
+		*seconds = value;
+	}
+	else if (*end == '\0' && value == (int) value) {
+		*iterations = (int) value;
+	}
+	else {
+		return false;
+	}
+
+	return true;
+}
+
+/** Start the worker pool of the search
+ * @param search Search to be initialised
+ * @param iterations Rollouts per move, 0 if the budget is a time
+ * @param seconds Time per move, 0 if the budget is rollouts
+ * @param threads Workers running rollouts, at least 1
+ * @param rollout Policy of the rollouts
+ * @param memoryLimit Bytes of the tree, 0 unlimited
+ * @param seed Seed of the rollouts
+ */
+void
+initMcts(mcts_t *search, int iterations, double seconds, int threads,
+	rollout_t rollout, size_t memoryLimit, uint32_t seed) {
+	int i;
+
+	// Rollouts use the packed row tables, built before the workers start
+	initRowTables();
+	initArena(&search -> nodes, MCTS_CHUNK);
+	pthread_mutex_init(&search -> lock, NULL);
+
+	search -> threads = threads < 1 ? 1 : threads;
+	search -> iterations = iterations;
+	search -> seconds = seconds;
+	search -> rollout = rollout;
+	search -> memoryLimit = memoryLimit;
+	search -> seed = seed;
+	search -> moves = 0;
+	search -> done = false;
+	search -> nextThread = 0;
+	pthread_barrier_init(&search -> start, NULL, search -> threads + 1);
+	pthread_barrier_init(&search -> finish, NULL, search -> threads + 1);
+
+	search -> workers = (pthread_t *) malloc(sizeof(pthread_t) *
+		search -> threads);
+	assert(search -> workers != NULL);
+	for (i = 0; i < search -> threads; i ++) {
+		pthread_create(&search -> workers[i], NULL, mctsWorker, search);
+	}
+}
+
+/** Search the board for the budget of a move, the tree is rebuilt for
+ * every move
+ * @param search Initialised search
+ * @param board The condition of the current board
+ * @param numberOfGeneratedNode Increased by the nodes of the tree
+ * @param numberOfExpandedNode Increased by the rollouts
+ * @return best_action Root move with the most visits
+ */
+move_t
+mctsMove(mcts_t *search, uint8_t board[SIZE][SIZE],
+	int *numberOfGeneratedNode, int *numberOfExpandedNode) {
+	mcts_node_t *child, *best = NULL;
+
+	resetArena(&search -> nodes);
+	search -> generated = 0;
+	search -> root = newNode(search, NULL, packBoard(board), false);
+	expandNode(search, search -> root);
+	if (search -> root -> child == NULL) {
+		return left;
+	}
+
+	search -> started = 0;
+	search -> finished = 0;
+	search -> degraded = false;
+	search -> scale = 1;
+	search -> deadline = wallClock() + search -> seconds;
+	pthread_barrier_wait(&search -> start);
+	pthread_barrier_wait(&search -> finish);
+	search -> moves ++;
+
+	// Most visited move, the mean breaks ties
+	for (child = search -> root -> child; child != NULL;
+		child = child -> sibling) {
+		if (best == NULL || child -> visits > best -> visits ||
+			(child -> visits == best -> visits && child -> reward >
+			best -> reward)) {
+			best = child;
+		}
+	}
+
+	*numberOfGeneratedNode += search -> generated;
+	*numberOfExpandedNode += search -> finished;
+
+	return best -> move;
+}
+
+/** Stop the worker pool and free the tree
+ * @param search Initialised search
+ */
+void
+freeMcts(mcts_t *search) {
+	int i;
+
+	search -> done = true;
+	pthread_barrier_wait(&search -> start);
+	for (i = 0; i < search -> threads; i ++) {
+		pthread_join(search -> workers[i], NULL);
+	}
+
+	pthread_barrier_destroy(&search -> start);
+	pthread_barrier_destroy(&search -> finish);
+	pthread_mutex_destroy(&search -> lock);
+	freeArena(&search -> nodes);
+	free(search -> workers);
+}
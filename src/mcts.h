@@ -0,0 +1,94 @@
+/*
+ ============================================================================
+ Name        : mcts.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Monte Carlo tree search with parallel rollouts
+ ============================================================================
+ */
+
+#ifndef __MCTS__
+#define __MCTS__
+
+#include <pthread.h>
+
+#include "utils.h"
+#include "memory.h"
+
+/*****************************CONSTANT***************************************/
+
+#define MCTS_EXPLORATION 0.5 // UCB constant, rewards are scaled to [0, 1]
+#define MCTS_CHUNK (1 << 20) // largest arena chunk of the tree
+#define MILLISECOND 1000
+
+/**
+ * Policy of the rollouts, random legal move or greedy on score plus empty
+ * cells (the policy of selfplay)
+ */
+typedef enum rollout {
+	ROLLOUT_RANDOM=0,
+	ROLLOUT_GREEDY=1
+} rollout_t;
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Node of the tree, a decision node holds the board before the move and
+ * has one chance child per legal move, a chance node holds the board after
+ * the move and has one decision child per spawn drawn so far. Boards are
+ * packed as packBoard
+ */
+typedef struct mcts_node_s {
+	uint64_t board;
+	double reward; // sum of the rewards backed up through the node
+	int visits;
+	int virtualLoss; // rollouts in flight, seen as visits without reward
+	uint32_t gain; // score of the move, chance nodes only
+	uint8_t move;
+	bool chance;
+	bool expanded;
+	struct mcts_node_s *parent;
+	struct mcts_node_s *child;
+	struct mcts_node_s *sibling;
+} mcts_node_t;
+
+/**
+ * Search shared with the worker pool, the tree is guarded by lock and the
+ * rollouts run outside of it
+ */
+typedef struct mcts_s {
+	arena_t nodes;
+	mcts_node_t *root;
+	pthread_mutex_t lock;
+	pthread_barrier_t start;
+	pthread_barrier_t finish;
+	pthread_t *workers;
+	int threads;
+	int iterations; // rollouts per move, 0 when the budget is a time
+	double seconds; // time per move, 0 when the budget is iterations
+	rollout_t rollout;
+	size_t memoryLimit; // bytes of the tree, 0 unlimited
+	uint32_t seed;
+	int moves; // searches so far, part of the seed of the rollouts
+	bool done; // set to release the workers
+	int nextThread; // index of the next worker to start
+
+	// Progress of the current search
+	int started;
+	int finished;
+	int generated;
+	double deadline;
+	double scale; // largest reward so far, rewards are divided by it
+	bool degraded; // the tree reached the memory limit
+} mcts_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+bool parseBudget(const char *text, int *iterations, double *seconds);
+void initMcts(mcts_t *search, int iterations, double seconds, int threads,
+	rollout_t rollout, size_t memoryLimit, uint32_t seed);
+move_t mctsMove(mcts_t *search, uint8_t board[SIZE][SIZE],
+	int *numberOfGeneratedNode, int *numberOfExpandedNode);
+void freeMcts(mcts_t *search);
+
+#endif
@@ -0,0 +1,447 @@
+/*
+ ============================================================================
+ Name        : memory.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Large allocations on huge pages and the local NUMA node
+ ============================================================================
+ */
+
+#define _GNU_SOURCE // mremap
+#include <sys/mman.h>
+#undef _XOPEN_SOURCE // defined again by utils.h, mremap is declared already
+
+#include "memory.h"
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#define MPOL_PREFERRED 1
+#define MPOL_LOCAL 4
+#endif
+
+/** Backing asked for large regions, transparent unless changed */
+static hugePages_t hugePages = HUGE_TRANSPARENT;
+
+/** Statistics of every thread, updated atomically */
+static size_t mapped[BACKINGS]; // bytes currently mapped per backing
+static size_t peakMapped;
+static int regions; // regions currently mapped
+static int explicitFallbacks; // MAP_HUGETLB refused, transparent used
+static int bindFailures; // mbind refused, first touch placement used
+
+static const char *backingName[BACKINGS] = {
+	"pages", "transparent_huge_pages", "explicit_huge_pages"
+};
+
+/*****************************REGION*FUNCTION********************************/
+
+/** Choose the backing of the following large regions
+ * @param mode Off, transparent or explicit huge pages
+ */
+void
+setHugePages(hugePages_t mode) {
+	hugePages = mode;
+}
+
+/** Round up to a multiple
+ * @param bytes Size to be rounded
+ * @param unit Power of two
+ * @return bytes Rounded size
+ */
+static size_t
+roundUp(size_t bytes, size_t unit) {
+	return (bytes + unit - 1) & ~(unit - 1);
+}
+
+/** Count a region in the statistics
+ * @param bytes Size of the region, negative when unmapped
+ * @param backing Backing of the region
+ * @param region +1 when mapped, -1 when unmapped, 0 when resized
+ */
+static void
+countRegion(long bytes, backing_t backing, int region) {
+	size_t total = 0;
+	int i;
+
+	__atomic_add_fetch(&mapped[backing], bytes, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&regions, region, __ATOMIC_RELAXED);
+
+	for (i = 0; i < BACKINGS; i ++) {
+		total += __atomic_load_n(&mapped[i], __ATOMIC_RELAXED);
+	}
+	if (total > __atomic_load_n(&peakMapped, __ATOMIC_RELAXED)) {
+		__atomic_store_n(&peakMapped, total, __ATOMIC_RELAXED);
+	}
+}
+
+/** Place the pages of a region on the node of the thread that faults them
+ * in, whatever the policy of the process (numactl --interleave...)
+ * @param region Start of the region
+ * @param bytes Size of the region
+ */
+static void
+bindLocal(void *region, size_t bytes) {
+#ifdef __linux__
+	if (syscall(SYS_mbind, region, bytes, MPOL_LOCAL, NULL, 0, 0) != 0 &&
+		syscall(SYS_mbind, region, bytes, MPOL_PREFERRED, NULL, 0, 0) != 0) {
+		__atomic_add_fetch(&bindFailures, 1, __ATOMIC_RELAXED);
+	}
+#endif
+}
+
+/** Map anonymous memory aligned on a huge page, so that transparent huge
+ * pages can back all of it
+ * @param bytes Size of the region, multiple of HUGE_PAGE
+ * @return region Start of the region, MAP_FAILED on failure
+ */
+static void
+*mapAligned(size_t bytes) {
+	uint8_t *raw = mmap(NULL, bytes + HUGE_PAGE, PROT_READ | PROT_WRITE, 
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (raw == MAP_FAILED) {
+		return MAP_FAILED;
+	}
+
+	uint8_t *region = (uint8_t *) roundUp((size_t) raw, HUGE_PAGE);
+	if (region > raw) {
+		munmap(raw, region - raw);
+	}
+	munmap(region + bytes, raw + HUGE_PAGE - region);
+
+	return region;
+}
+
+/** Map a large zeroed region, on huge pages when asked for and large
+ * enough, bound to the local node
+ * @param size Size wanted, updated to the size mapped
+ * @param backing Backing the region got
+ * @param explicit Whether MAP_HUGETLB may be used
+ * @return region Start of the region
+ */
+static void
+*mapRegion(size_t *size, backing_t *backing, bool explicit) {
+	size_t bytes = roundUp(*size, PAGE);
+	void *region = MAP_FAILED;
+
+	*backing = BACKING_PAGES;
+
+	if (explicit && hugePages == HUGE_EXPLICIT && bytes >= HUGE_PAGE) {
+#ifdef MAP_HUGETLB
+		region = mmap(NULL, roundUp(bytes, HUGE_PAGE), PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+		if (region != MAP_FAILED) {
+			*backing = BACKING_EXPLICIT;
+			bytes = roundUp(bytes, HUGE_PAGE);
+		}
+		else {
+			__atomic_add_fetch(&explicitFallbacks, 1, __ATOMIC_RELAXED);
+		}
+	}
+
+	if (region == MAP_FAILED && hugePages != HUGE_OFF && bytes >= HUGE_PAGE) {
+		bytes = roundUp(bytes, HUGE_PAGE);
+		region = mapAligned(bytes);
+		if (region != MAP_FAILED && madvise(region, bytes, MADV_HUGEPAGE) == 0) {
+			*backing = BACKING_TRANSPARENT;
+		}
+	}
+
+	if (region == MAP_FAILED) {
+		region = mmap(NULL, bytes, PROT_READ | PROT_WRITE, 
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	assert(region != MAP_FAILED);
+
+	bindLocal(region, bytes);
+	countRegion(bytes, *backing, 1);
+	*size = bytes;
+	return region;
+}
+
+/** Allocate a large zeroed region, on huge pages when asked for and large
+ * enough, bound to the local node
+ * @param bytes Size wanted, updated to the size mapped (rounded up to 
+ * pages, or huge pages when used)
+ * @param backing Backing the region got
+ * @return region Start of the region, freed by freeLarge
+ */
+void
+*allocLarge(size_t *bytes, backing_t *backing) {
+	return mapRegion(bytes, backing, true);
+}
+
+/** Backing of a region grown by resizeLarge
+ * @param bytes Size of the region
+ * @return backing Transparent huge pages once large enough
+ */
+static backing_t
+resizedBacking(size_t bytes) {
+	return hugePages != HUGE_OFF && roundUp(bytes, PAGE) >= HUGE_PAGE ? 
+		BACKING_TRANSPARENT : BACKING_PAGES;
+}
+
+/** Grow or shrink a region from allocLarge (never explicit huge pages, 
+ * allocate it with setHugePages off or transparent), the content is kept
+ * @param region Start of the region, NULL to allocate
+ * @param oldBytes Size of the region
+ * @param newBytes Size wanted
+ * @return region Start of the resized region
+ */
+void
+*resizeLarge(void *region, size_t oldBytes, size_t newBytes) {
+	backing_t backing;
+
+	// Sizes are rounded the same way whatever the backing
+	oldBytes = roundUp(oldBytes, resizedBacking(oldBytes) == BACKING_PAGES ?
+		PAGE : HUGE_PAGE);
+	newBytes = roundUp(newBytes, resizedBacking(newBytes) == BACKING_PAGES ?
+		PAGE : HUGE_PAGE);
+
+	if (region == NULL) {
+		return mapRegion(&newBytes, &backing, false);
+	}
+	if (oldBytes == newBytes) {
+		return region;
+	}
+
+	void *resized = mremap(region, oldBytes, newBytes, MREMAP_MAYMOVE);
+	assert(resized != MAP_FAILED);
+
+	backing = resizedBacking(newBytes);
+	if (backing == BACKING_TRANSPARENT) {
+		madvise(resized, newBytes, MADV_HUGEPAGE);
+	}
+	bindLocal(resized, newBytes);
+
+	countRegion(-(long) oldBytes, resizedBacking(oldBytes), 0);
+	countRegion(newBytes, backing, 0);
+	return resized;
+}
+
+/** Unmap a region from allocLarge or resizeLarge
+ * @param region Start of the region
+ * @param bytes Size mapped by allocLarge, or asked from resizeLarge
+ * @param backing Backing from allocLarge, or BACKINGS after resizeLarge
+ */
+void
+freeLarge(void *region, size_t bytes, backing_t backing) {
+	if (region == NULL) {
+		return;
+	}
+
+	if (backing == BACKINGS) {
+		backing = resizedBacking(bytes);
+		bytes = roundUp(bytes, backing == BACKING_PAGES ? PAGE : HUGE_PAGE);
+	}
+	munmap(region, bytes);
+	countRegion(-(long) bytes, backing, -1);
+}
+
+/** Node of up to PLACEMENT_SAMPLES pages spread over the region
+ * @param region Start of the region
+ * @param bytes Size of the region
+ * @param placement Counts per node, increased
+ */
+void
+samplePlacement(void *region, size_t bytes, placement_t *placement) {
+	void *pages[PLACEMENT_SAMPLES];
+	int status[PLACEMENT_SAMPLES];
+	size_t count = bytes / PAGE, step, i;
+
+	if (region == NULL || count == 0) {
+		return;
+	}
+	step = count > PLACEMENT_SAMPLES ? count / PLACEMENT_SAMPLES : 1;
+	count = count > PLACEMENT_SAMPLES ? PLACEMENT_SAMPLES : count;
+
+	for (i = 0; i < count; i ++) {
+		pages[i] = (uint8_t *) region + i * step * PAGE;
+		status[i] = -1;
+	}
+
+#ifdef __linux__
+	// Without target nodes move_pages only reports where the pages are
+	if (syscall(SYS_move_pages, 0, count, pages, NULL, status, 0) != 0) {
+		placement -> unknown += count;
+		return;
+	}
+#endif
+
+	for (i = 0; i < count; i ++) {
+		if (status[i] >= 0 && status[i] < MAX_NUMA_NODES) {
+			placement -> pages[status[i]] ++;
+		}
+		else {
+			placement -> unknown ++;
+		}
+	}
+}
+
+/*****************************ARENA*FUNCTION*********************************/
+
+/** Initialise an empty arena, nothing is mapped before the first alloc
+ * @param arena Arena to be initialised
+ * @param maxChunk Largest chunk, at least a page
+ */
+void
+initArena(arena_t *arena, size_t maxChunk) {
+	arena -> first = arena -> current = NULL;
+	arena -> offset = 0;
+	arena -> reserved = 0;
+	arena -> maxChunk = maxChunk < PAGE ? PAGE : maxChunk;
+}
+
+/** Size of the chunk that follows the current one
+ * @param arena Arena
+ * @param bytes Allocation that needs the chunk
+ * @return size Bytes of the chunk
+ */
+static size_t
+chunkSize(arena_t *arena, size_t bytes) {
+	size_t size = arena -> current == NULL ? ARENA_CHUNK : 
+		arena -> current -> size * ARENA_GROWTH;
+	size_t needed = roundUp(sizeof(chunk_t), ARENA_ALIGN) + bytes;
+
+	size = size > arena -> maxChunk ? arena -> maxChunk : size;
+	return roundUp(size > needed ? size : needed, PAGE);
+}
+
+/** Allocate from the arena, freed all at once by resetArena or freeArena
+ * @param arena Arena
+ * @param bytes Size wanted
+ * @return memory Aligned on ARENA_ALIGN
+ */
+void
+*arenaAlloc(arena_t *arena, size_t bytes) {
+	bytes = roundUp(bytes, ARENA_ALIGN);
+
+	// Chunks kept by resetArena are used again before mapping new ones
+	while (arena -> current == NULL || 
+		arena -> offset + bytes > arena -> current -> size) {
+		if (arena -> current != NULL && arena -> current -> next != NULL) {
+			arena -> current = arena -> current -> next;
+		}
+		else {
+			backing_t backing;
+			size_t size = chunkSize(arena, bytes);
+			chunk_t *chunk = (chunk_t *) allocLarge(&size, &backing);
+
+			chunk -> next = NULL;
+			chunk -> size = size;
+			chunk -> backing = backing;
+			if (arena -> current == NULL) {
+				arena -> first = chunk;
+			}
+			else {
+				arena -> current -> next = chunk;
+			}
+			arena -> current = chunk;
+			arena -> reserved += size;
+		}
+		arena -> offset = roundUp(sizeof(chunk_t), ARENA_ALIGN);
+	}
+
+	void *memory = (uint8_t *) arena -> current + arena -> offset;
+	arena -> offset += bytes;
+	return memory;
+}
+
+/** Bytes that arenaAlloc would newly map for an allocation
+ * @param arena Arena
+ * @param bytes Size of the allocation
+ * @return size 0 if it fits in the chunks already mapped
+ */
+size_t
+arenaNextChunk(arena_t *arena, size_t bytes) {
+	bytes = roundUp(bytes, ARENA_ALIGN);
+
+	if (arena -> current != NULL && 
+		(arena -> offset + bytes <= arena -> current -> size || 
+		arena -> current -> next != NULL)) {
+		return 0;
+	}
+
+	return chunkSize(arena, bytes);
+}
+
+/** Free every allocation but keep the chunks for the next ones
+ * @param arena Arena
+ */
+void
+resetArena(arena_t *arena) {
+	arena -> current = arena -> first;
+	arena -> offset = roundUp(sizeof(chunk_t), ARENA_ALIGN);
+}
+
+/** Unmap every chunk
+ * @param arena Arena
+ */
+void
+freeArena(arena_t *arena) {
+	chunk_t *chunk = arena -> first;
+
+	while (chunk != NULL) {
+		chunk_t *next = chunk -> next;
+		freeLarge(chunk, chunk -> size, chunk -> backing);
+		chunk = next;
+	}
+
+	initArena(arena, arena -> maxChunk);
+}
+
+/** Placement of the pages of every chunk
+ * @param arena Arena
+ * @param placement Counts per node, increased
+ */
+void
+arenaPlacement(arena_t *arena, placement_t *placement) {
+	chunk_t *chunk;
+
+	for (chunk = arena -> first; chunk != NULL; chunk = chunk -> next) {
+		samplePlacement(chunk, chunk -> size, placement);
+	}
+}
+
+/*****************************STATISTICS*FUNCTION****************************/
+
+/** Write the statistics of the large regions to a json file
+ * @param path File to be written
+ * @param placement Sampled placement of the regions of interest (can be 
+ * NULL)
+ */
+void
+printMemoryStats(const char *path, placement_t *placement) {
+	int i;
+
+	/** File open */
+	FILE *fp = fopen(path, "w");
+	assert(fp != NULL);
+
+	fprintf(fp, "{\n  \"huge_pages\": \"%s\",\n", hugePages == HUGE_OFF ? 
+		"off" : hugePages == HUGE_TRANSPARENT ? "transparent" : "explicit");
+	for (i = 0; i < BACKINGS; i ++) {
+		fprintf(fp, "  \"%s_bytes\": %zu,\n", backingName[i], mapped[i]);
+	}
+	fprintf(fp, "  \"peak_mapped_bytes\": %zu,\n", peakMapped);
+	fprintf(fp, "  \"regions\": %d,\n", regions);
+	fprintf(fp, "  \"explicit_fallbacks\": %d,\n", explicitFallbacks);
+	fprintf(fp, "  \"bind_failures\": %d,\n", bindFailures);
+
+	fprintf(fp, "  \"placement_pages\": {");
+	if (placement != NULL) {
+		bool comma = false;
+		for (i = 0; i < MAX_NUMA_NODES; i ++) {
+			if (placement -> pages[i]) {
+				fprintf(fp, "%s\"node%d\": %d", comma ? ", " : "", i, 
+					placement -> pages[i]);
+				comma = true;
+			}
+		}
+		fprintf(fp, "%s\"unknown\": %d", comma ? ", " : "", 
+			placement -> unknown);
+	}
+	fprintf(fp, "}\n}\n");
+
+	fclose(fp);
+}
@@ -0,0 +1,98 @@
+/*
+ ============================================================================
+ Name        : memory.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Large allocations on huge pages and the local NUMA node
+ ============================================================================
+ */
+
+#ifndef __MEMORY__
+#define __MEMORY__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+#define PAGE 4096
+#define HUGE_PAGE (2 * 1024 * 1024)
+#define ARENA_CHUNK (64 * 1024) // first chunk of an arena
+#define ARENA_MAX_CHUNK (64 * 1024 * 1024) // chunks stop doubling there
+#define ARENA_ALIGN 16
+#define ARENA_GROWTH 2
+#define ARENA_BUDGET_SHARE 4 // chunks under a memory limit
+#define MAX_NUMA_NODES 64
+#define PLACEMENT_SAMPLES 256 // pages queried per region for placement
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * How large regions are backed, explicit tries MAP_HUGETLB first (needs
+ * vm.nr_hugepages) then falls back to transparent huge pages, then pages
+ */
+typedef enum hugePages {
+	HUGE_OFF = 0,
+	HUGE_TRANSPARENT = 1,
+	HUGE_EXPLICIT = 2
+} hugePages_t;
+
+/**
+ * What a region actually got
+ */
+typedef enum backing {
+	BACKING_PAGES = 0,
+	BACKING_TRANSPARENT = 1,
+	BACKING_EXPLICIT = 2,
+	BACKINGS = 3
+} backing_t;
+
+/**
+ * Chunk of an arena, the header lives at the start of the region
+ */
+typedef struct chunk_s {
+	struct chunk_s *next;
+	size_t size; // bytes of the region, header included
+	backing_t backing;
+} chunk_t;
+
+/**
+ * Bump allocator over large chunks, reset keeps the chunks so the next 
+ * search reuses pages already faulted in (on the node of its thread)
+ */
+typedef struct arena_s {
+	chunk_t *first;
+	chunk_t *current;
+	size_t offset; // next free byte of current
+	size_t reserved; // bytes of every chunk
+	size_t maxChunk; // chunks never get larger than this
+} arena_t;
+
+/**
+ * Placement of sampled pages, per NUMA node
+ */
+typedef struct placement_s {
+	int pages[MAX_NUMA_NODES];
+	int unknown; // not faulted in or not queryable
+} placement_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+/** Large regions */
+void setHugePages(hugePages_t mode);
+void *allocLarge(size_t *bytes, backing_t *backing);
+void *resizeLarge(void *region, size_t oldBytes, size_t newBytes);
+void freeLarge(void *region, size_t bytes, backing_t backing);
+void samplePlacement(void *region, size_t bytes, placement_t *placement);
+
+/** Arena */
+void initArena(arena_t *arena, size_t maxChunk);
+void *arenaAlloc(arena_t *arena, size_t bytes);
+size_t arenaNextChunk(arena_t *arena, size_t bytes);
+void resetArena(arena_t *arena);
+void freeArena(arena_t *arena);
+void arenaPlacement(arena_t *arena, placement_t *placement);
+
+/** Statistics */
+void printMemoryStats(const char *path, placement_t *placement);
+
+#endif
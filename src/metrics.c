@@ -0,0 +1,215 @@
+/*
+ ============================================================================
+ Name        : metrics.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Wall clock timing and per move statistics of the AI
+ ============================================================================
+ */
+
+#include "metrics.h"
+#include "ai.h"
+
+/*****************************TIMING*FUNCTION********************************/
+
+/** Monotonic wall clock, unlike clock() it keeps counting real time when
+ * the search runs on several threads
+ * @return seconds Seconds since an arbitrary fixed point
+ */
+double
+wallClock() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / NANOSECOND;
+}
+
+/*****************************METRICS*FUNCTION*******************************/
+
+/** Initialize empty statistics for one game
+ * @param metrics Statistics to be initialized
+ */
+void
+initMetrics(metrics_t *metrics) {
+	metrics -> latency = (double *) malloc(sizeof(double) * INITIAL_LATENCY);
+	assert(metrics -> latency != NULL);
+	metrics -> nLatency = 0;
+	metrics -> sizeLatency = INITIAL_LATENCY;
+	metrics -> peakMemory = 0;
+	metrics -> degraded = 0;
+	metrics -> firstDegraded = -1;
+	metrics -> bookMoves = 0;
+	metrics -> extensions = metrics -> reductions = 0;
+	metrics -> budgetMoves = 0;
+}
+
+/** Record a single get_next_move call
+ * @param metrics Statistics of the game
+ * @param seconds Wall time of the call
+ * @param memory Memory used by the search of the call
+ * @param degraded Whether the search reached the memory limit
+ */
+void
+recordMove(metrics_t *metrics, double seconds, size_t memory, 
+	bool degraded) {
+	// Realloc if neccessary
+	if (metrics -> nLatency == metrics -> sizeLatency) {
+		metrics -> sizeLatency *= REALLOC_FACTOR;
+		metrics -> latency = realloc(metrics -> latency, sizeof(double) * 
+			metrics -> sizeLatency);
+		assert(metrics -> latency != NULL);
+	}
+
+	metrics -> latency[metrics -> nLatency ++] = seconds;
+
+	if (memory > metrics -> peakMemory) {
+		metrics -> peakMemory = memory;
+	}
+
+	if (degraded) {
+		if (metrics -> degraded ++ == 0) {
+			metrics -> firstDegraded = metrics -> nLatency - 1;
+		}
+	}
+}
+
+/** Record what the selective search did in a single get_next_move call
+ * @param metrics Statistics of the game
+ * @param extensions Nodes searched one level deeper
+ * @param reductions Nodes searched one level shallower
+ * @param budgetReached Whether the search reached its node budget
+ */
+void
+recordSelectivity(metrics_t *metrics, int extensions, int reductions,
+	bool budgetReached) {
+	metrics -> extensions += extensions;
+	metrics -> reductions += reductions;
+	metrics -> budgetMoves += budgetReached;
+}
+
+/** Comparison of two latency used by qsort
+ */
+static int
+compareLatency(const void *a, const void *b) {
+	double x = *(const double *) a;
+	double y = *(const double *) b;
+
+	return (x > y) - (x < y);
+}
+
+/** Nearest rank percentile of the latency recorded so far
+ * @param metrics Statistics of the game
+ * @param percent Percentile wanted, 100 gives the maximum
+ * @return seconds Latency at that percentile, 0 if nothing recorded
+ */
+double
+latencyPercentile(metrics_t *metrics, double percent) {
+	int n = metrics -> nLatency;
+	int rank;
+	double result;
+
+	if (n == 0) {
+		return 0;
+	}
+
+	// Sort a copy so the order of the moves is kept
+	double *sorted = (double *) malloc(sizeof(double) * n);
+	assert(sorted != NULL);
+	memcpy(sorted, metrics -> latency, sizeof(double) * n);
+	qsort(sorted, n, sizeof(double), compareLatency);
+
+	rank = (int) ceil(percent / PERCENT * n) - 1;
+	if (rank < 0) {
+		rank = 0;
+	}
+	result = sorted[rank];
+
+	free(sorted);
+	return result;
+}
+
+/** Free the statistics
+ * @param metrics Statistics of the game
+ */
+void
+freeMetrics(metrics_t *metrics) {
+	free(metrics -> latency);
+}
+
+/*****************************OUTPUT*FUNCTION********************************/
+
+/** Print every statistics to output.json, the legacy output.txt fields are
+ * repeated so this file alone describes the game
+ * @param metrics Statistics of the game
+ * @param max_depth Maximum depth of expansion
+ * @param propagation Type of propagation
+ * @param numberOfGeneratedNode Number of nodes that are applied action
+ * @param numberOfExpandedNode Number of nodes out of heap
+ * @param numberOfPrunedNode Number of nodes skipped by branch and bound
+ * @param searchTime Wall time of search until game over
+ * @param maxTile Maximum value in board
+ * @param score Score when game over
+ */
+void
+printMetrics(metrics_t *metrics, int max_depth, propagation_t propagation,
+	int numberOfGeneratedNode, int numberOfExpandedNode, 
+	int numberOfPrunedNode, double searchTime, uint8_t maxTile, 
+	uint32_t score) {
+	int histogram[HISTOGRAM_BUCKETS] = {0};
+	int i, bucket, last = 0;
+
+	// Bucket i holds latency in [2^(i-1), 2^i) microseconds
+	for (i = 0; i < metrics -> nLatency; i ++) {
+		double us = metrics -> latency[i] * MICROSECOND;
+		bucket = 0;
+		while (us >= 1 && bucket < HISTOGRAM_BUCKETS - 1) {
+			us /= BASE;
+			bucket ++;
+		}
+		histogram[bucket] ++;
+		if (bucket > last) {
+			last = bucket;
+		}
+	}
+
+	/** File open */
+	FILE *fp = fopen("output.json", "w");
+	assert(fp != NULL);
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"max_depth\": %d,\n", max_depth);
+	fprintf(fp, "  \"propagation\": \"%s\",\n", 
+		propagation == max ? "max" : propagation == avg ? "avg" : "mcts");
+	fprintf(fp, "  \"generated\": %d,\n", numberOfGeneratedNode);
+	fprintf(fp, "  \"expanded\": %d,\n", numberOfExpandedNode);
+	fprintf(fp, "  \"pruned\": %d,\n", numberOfPrunedNode);
+	fprintf(fp, "  \"time_seconds\": %.6f,\n", searchTime);
+	fprintf(fp, "  \"expanded_per_second\": %.2f,\n", numberOfExpandedNode / 
+		(searchTime < EPSILON ? EPSILON : searchTime));
+	fprintf(fp, "  \"max_tile\": %d,\n", (int) pow(BASE, maxTile));
+	fprintf(fp, "  \"score\": %u,\n", score);
+	fprintf(fp, "  \"moves\": %d,\n", metrics -> nLatency);
+	fprintf(fp, "  \"peak_search_memory_bytes\": %zu,\n", 
+		metrics -> peakMemory);
+	fprintf(fp, "  \"degraded_moves\": %d,\n", metrics -> degraded);
+	fprintf(fp, "  \"first_degraded_move\": %d,\n", metrics -> firstDegraded);
+	fprintf(fp, "  \"book_moves\": %d,\n", metrics -> bookMoves);
+	fprintf(fp, "  \"extensions\": %ld,\n", metrics -> extensions);
+	fprintf(fp, "  \"reductions\": %ld,\n", metrics -> reductions);
+	fprintf(fp, "  \"node_budget_moves\": %d,\n", metrics -> budgetMoves);
+	fprintf(fp, "  \"latency_seconds\": {\"p50\": %.9f, \"p90\": %.9f, "
+		"\"p99\": %.9f, \"max\": %.9f},\n", 
+		latencyPercentile(metrics, 50), latencyPercentile(metrics, 90), 
+		latencyPercentile(metrics, 99), latencyPercentile(metrics, PERCENT));
+
+	// Histogram up to the highest non empty bucket
+	fprintf(fp, "  \"latency_histogram_log2_us\": [");
+	for (i = 0; i <= last; i ++) {
+		fprintf(fp, "%s%d", i ? ", " : "", histogram[i]);
+	}
+	fprintf(fp, "]\n");
+	fprintf(fp, "}\n");
+
+	fclose(fp);
+}
@@ -0,0 +1,58 @@
+/*
+ ============================================================================
+ Name        : metrics.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Wall clock timing and per move statistics of the AI
+ ============================================================================
+ */
+
+#ifndef __METRICS__
+#define __METRICS__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+#define INITIAL_LATENCY 64 // initial capacity of the latency array
+#define HISTOGRAM_BUCKETS 32 // log2 buckets of microseconds
+#define MICROSECOND 1e6
+#define NANOSECOND 1e9
+#define PERCENT 100.0
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Statistics gathered while playing one game
+ */
+typedef struct metrics_s {
+	double *latency; // wall time of every get_next_move in seconds
+	int nLatency;
+	int sizeLatency;
+	size_t peakMemory; // highest memory used by a single search in bytes
+	int degraded; // searches that reached the memory limit
+	int firstDegraded; // index of the first of them, -1 if none
+	int bookMoves; // moves taken from the opening book without a search
+	long extensions; // nodes the selective search searched deeper
+	long reductions; // nodes the selective search searched shallower
+	int budgetMoves; // searches that reached their node budget
+} metrics_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+double wallClock();
+
+void initMetrics(metrics_t *metrics);
+void recordMove(metrics_t *metrics, double seconds, size_t memory, 
+	bool degraded);
+void recordSelectivity(metrics_t *metrics, int extensions, int reductions,
+	bool budgetReached);
+double latencyPercentile(metrics_t *metrics, double percent);
+void freeMetrics(metrics_t *metrics);
+
+void printMetrics(metrics_t *metrics, int max_depth, propagation_t propagation,
+	int numberOfGeneratedNode, int numberOfExpandedNode, 
+	int numberOfPrunedNode, double searchTime, uint8_t maxTile, 
+	uint32_t score);
+
+#endif
@@ -8,14 +8,32 @@
  */
 struct node_s{
     uint32_t priority;
-    int depth;
+    uint32_t bound; // upper bound of the subtree, set once it is expanded
     int num_childs;
-    move_t move;
+    uint8_t depth; // kept small with the move so the node stays 48 bytes
+    uint8_t move; // move_t
+    uint8_t monotonic; // bit i set if row i, SIZE + j if column j is monotonic
+    uint8_t horizon; // depth at which the subtree of the node stops
     uint8_t board[SIZE][SIZE];
+    uint8_t rowEmpty[SIZE]; // empty cells of every row, kept incrementally
+    uint8_t columnEmpty[SIZE]; // empty cells of every column
     struct node_s* parent;
 };
 
 typedef struct node_s node_t;
 
+/**
+ * Lightweight frontier entry, the child board is only built from parent
+ * and move once the entry is popped
+ */
+struct frontier_s{
+    uint32_t priority;
+    uint8_t move; // move_t, kept small so the entry stays 16 bytes
+    bool reduced; // dominated by a sibling, searched one level shallower
+    struct node_s* parent;
+};
+
+typedef struct frontier_s frontier_t;
+
 
 #endif
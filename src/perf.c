@@ -0,0 +1,195 @@
+/*
+ ============================================================================
+ Name        : perf.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Hardware performance counters around get_next_move (Linux)
+ ============================================================================
+ */
+
+#include "perf.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+/** Name of every event, in the order of perf_t arrays */
+static const char *perfName[PERF_EVENTS] = {
+	"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses",
+	"dtlb_misses"
+};
+
+/****************************COUNTER*FUNCTION********************************/
+
+#ifdef __linux__
+/** Open one user space counter of the calling thread, disabled. It is 
+ * inherited by the threads created afterwards, such as the mcts workers, 
+ * and reading it sums all of them
+ * @param type PERF_TYPE_HARDWARE or PERF_TYPE_HW_CACHE
+ * @param config Event of that type
+ * @return fd Counter or PERF_UNAVAILABLE
+ */
+static int
+openCounter(uint32_t type, uint64_t config) {
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1; // allowed with perf_event_paranoid = 2
+	attr.exclude_hv = 1;
+	attr.inherit = 1; // the nodes of every thread are counted as well
+
+	int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+	return fd < 0 ? PERF_UNAVAILABLE : fd;
+}
+#endif
+
+/** Open every counter and the per move csv
+ * @param perf Counters to be initialized
+ * @return bool True if at least one counter is available
+ */
+bool
+initPerf(perf_t *perf) {
+	bool available = false;
+	int i;
+
+	memset(perf, 0, sizeof(perf_t));
+	for (i = 0; i < PERF_EVENTS; i ++) {
+		perf -> fd[i] = PERF_UNAVAILABLE;
+	}
+
+#ifdef __linux__
+	perf -> fd[0] = openCounter(PERF_TYPE_HARDWARE, 
+		PERF_COUNT_HW_CPU_CYCLES);
+	perf -> fd[1] = openCounter(PERF_TYPE_HARDWARE, 
+		PERF_COUNT_HW_INSTRUCTIONS);
+	perf -> fd[2] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | 
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) | 
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	perf -> fd[3] = openCounter(PERF_TYPE_HARDWARE, 
+		PERF_COUNT_HW_CACHE_MISSES);
+	perf -> fd[4] = openCounter(PERF_TYPE_HARDWARE, 
+		PERF_COUNT_HW_BRANCH_MISSES);
+	perf -> fd[5] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) | 
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#endif
+
+	for (i = 0; i < PERF_EVENTS; i ++) {
+		available |= perf -> fd[i] != PERF_UNAVAILABLE;
+	}
+
+	perf -> fp = fopen("perf_counters.csv", "w");
+	assert(perf -> fp != NULL);
+	fprintf(perf -> fp, "move,expanded");
+	for (i = 0; i < PERF_EVENTS; i ++) {
+		fprintf(perf -> fp, ",%s,%s_per_node", perfName[i], perfName[i]);
+	}
+	fprintf(perf -> fp, "\n");
+
+	return available;
+}
+
+/** Reset and enable every counter right before get_next_move
+ * @param perf Counters of the game
+ */
+void
+startPerf(perf_t *perf) {
+#ifdef __linux__
+	int i;
+
+	for (i = 0; i < PERF_EVENTS; i ++) {
+		if (perf -> fd[i] != PERF_UNAVAILABLE) {
+			ioctl(perf -> fd[i], PERF_EVENT_IOC_RESET, 0);
+			ioctl(perf -> fd[i], PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+#endif
+}
+
+/** Disable every counter right after get_next_move and write the move
+ * @param perf Counters of the game
+ * @param move Index of the move in the game
+ * @param numberOfExpandedNode Nodes expanded by this move only
+ */
+void
+stopPerf(perf_t *perf, int move, int numberOfExpandedNode) {
+	uint64_t value;
+	int i;
+
+	fprintf(perf -> fp, "%d,%d", move, numberOfExpandedNode);
+	perf -> nodes += numberOfExpandedNode;
+
+	for (i = 0; i < PERF_EVENTS; i ++) {
+		value = 0;
+#ifdef __linux__
+		if (perf -> fd[i] != PERF_UNAVAILABLE) {
+			ioctl(perf -> fd[i], PERF_EVENT_IOC_DISABLE, 0);
+			if (read(perf -> fd[i], &value, sizeof(value)) != sizeof(value)) {
+				value = 0;
+			}
+		}
+#endif
+		perf -> total[i] += value;
+
+		// Empty field when the counter does not exist on this machine
+		if (perf -> fd[i] == PERF_UNAVAILABLE) {
+			fprintf(perf -> fp, ",,");
+		}
+		else {
+			fprintf(perf -> fp, ",%llu,%.3f", (unsigned long long) value, 
+				numberOfExpandedNode ? (double) value / numberOfExpandedNode : 0);
+		}
+	}
+	fprintf(perf -> fp, "\n");
+}
+
+/** Print the game totals, raw and normalized per expanded node, to
+ * perf_counters.json
+ * @param perf Counters of the game
+ */
+void
+printPerf(perf_t *perf) {
+	int i;
+
+	/** File open */
+	FILE *fp = fopen("perf_counters.json", "w");
+	assert(fp != NULL);
+
+	fprintf(fp, "{\n  \"expanded\": %llu", (unsigned long long) perf -> nodes);
+	for (i = 0; i < PERF_EVENTS; i ++) {
+		if (perf -> fd[i] == PERF_UNAVAILABLE) {
+			fprintf(fp, ",\n  \"%s\": null,\n  \"%s_per_node\": null", 
+				perfName[i], perfName[i]);
+		}
+		else {
+			fprintf(fp, ",\n  \"%s\": %llu,\n  \"%s_per_node\": %.3f", 
+				perfName[i], (unsigned long long) perf -> total[i], 
+				perfName[i], perf -> nodes ? 
+				(double) perf -> total[i] / perf -> nodes : 0);
+		}
+	}
+	fprintf(fp, "\n}\n");
+
+	fclose(fp);
+}
+
+/** Close every counter and the per move csv
+ * @param perf Counters of the game
+ */
+void
+freePerf(perf_t *perf) {
+	int i;
+
+	for (i = 0; i < PERF_EVENTS; i ++) {
+		if (perf -> fd[i] != PERF_UNAVAILABLE) {
+			close(perf -> fd[i]);
+		}
+	}
+	fclose(perf -> fp);
+}
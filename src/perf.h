@@ -0,0 +1,41 @@
+/*
+ ============================================================================
+ Name        : perf.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Hardware performance counters around get_next_move (Linux)
+ ============================================================================
+ */
+
+#ifndef __PERF__
+#define __PERF__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+#define PERF_EVENTS 6 // cycles, instructions, L1D, LLC, branch, dTLB misses
+#define PERF_UNAVAILABLE -1
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Counters of one game, fd is PERF_UNAVAILABLE when the kernel refused
+ * that event (no PMU, perf_event_paranoid, virtual machine...)
+ */
+typedef struct perf_s {
+	int fd[PERF_EVENTS];
+	uint64_t total[PERF_EVENTS]; // sum over every move of the game
+	uint64_t nodes; // expanded nodes over every move of the game
+	FILE *fp; // per move csv
+} perf_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+bool initPerf(perf_t *perf);
+void startPerf(perf_t *perf);
+void stopPerf(perf_t *perf, int move, int numberOfExpandedNode);
+void printPerf(perf_t *perf);
+void freePerf(perf_t *perf);
+
+#endif
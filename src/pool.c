@@ -0,0 +1,105 @@
+/*
+ ============================================================================
+ Name        : pool.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Pool of search threads running batches of numbered jobs
+ ============================================================================
+ */
+
+#include "pool.h"
+#include "ai.h"
+
+/*****************************WORKER*FUNCTION********************************/
+
+/** Worker of the pool, runs the jobs of every batch with its own search
+ * until the pool is freed
+ * @param arg Pool shared with the other workers
+ */
+static void
+*poolWorker(void *arg) {
+	pool_t *pool = (pool_t *) arg;
+	int i;
+
+	initialize_ai();
+	if (pool -> setup != NULL) {
+		pool -> setup(pool -> context);
+	}
+
+	while (true) {
+		pthread_barrier_wait(&pool -> start);
+		if (pool -> done) {
+			break;
+		}
+
+		while ((i = __atomic_fetch_add(&pool -> next, 1, __ATOMIC_RELAXED)) <
+			pool -> jobs) {
+			pool -> job(pool -> context, i);
+		}
+
+		pthread_barrier_wait(&pool -> finish);
+	}
+
+	freeAI();
+	return NULL;
+}
+
+/*****************************POOL*FUNCTION**********************************/
+
+/** Start the workers, they wait for the first batch
+ * @param pool Pool to be started
+ * @param threads Number of workers, at least 1
+ * @param job Job run for every index of a batch
+ * @param setup Called by every worker before its first job (can be NULL)
+ * @param context Given to job and setup
+ */
+void
+initPool(pool_t *pool, int threads, poolJob_t job, poolSetup_t setup,
+	void *context) {
+	int i;
+
+	pool -> job = job;
+	pool -> setup = setup;
+	pool -> context = context;
+	pool -> threads = threads;
+	pool -> jobs = pool -> next = 0;
+	pool -> done = false;
+	pthread_barrier_init(&pool -> start, NULL, threads + 1);
+	pthread_barrier_init(&pool -> finish, NULL, threads + 1);
+
+	pool -> workers = (pthread_t *) malloc(sizeof(pthread_t) * threads);
+	assert(pool -> workers != NULL);
+	for (i = 0; i < threads; i ++) {
+		pthread_create(&pool -> workers[i], NULL, poolWorker, pool);
+	}
+}
+
+/** Run jobs 0 to jobs - 1 on the workers and wait for all of them
+ * @param pool Started pool
+ * @param jobs Number of jobs of the batch
+ */
+void
+runPool(pool_t *pool, int jobs) {
+	pool -> jobs = jobs;
+	pool -> next = 0;
+	pthread_barrier_wait(&pool -> start);
+	pthread_barrier_wait(&pool -> finish);
+}
+
+/** Release the workers and wait for them to exit
+ * @param pool Started pool
+ */
+void
+freePool(pool_t *pool) {
+	int i;
+
+	pool -> done = true;
+	pthread_barrier_wait(&pool -> start);
+	for (i = 0; i < pool -> threads; i ++) {
+		pthread_join(pool -> workers[i], NULL);
+	}
+
+	pthread_barrier_destroy(&pool -> start);
+	pthread_barrier_destroy(&pool -> finish);
+	free(pool -> workers);
+}
@@ -0,0 +1,53 @@
+/*
+ ============================================================================
+ Name        : pool.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Pool of search threads running batches of numbered jobs
+ ============================================================================
+ */
+
+#ifndef __POOL__
+#define __POOL__
+
+#include <pthread.h>
+
+#include "utils.h"
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Job i of a batch, run by any worker with the context of the pool
+ */
+typedef void (*poolJob_t)(void *context, int job);
+
+/**
+ * Called once by every worker after initialize_ai, NULL if not needed
+ */
+typedef void (*poolSetup_t)(void *context);
+
+/**
+ * Workers wait on start, take jobs through next until jobs is reached and
+ * meet the caller on finish, done releases them on the next start
+ */
+typedef struct pool_s {
+	poolJob_t job;
+	poolSetup_t setup;
+	void *context;
+	pthread_t *workers;
+	int threads;
+	int jobs;
+	int next;
+	bool done;
+	pthread_barrier_t start;
+	pthread_barrier_t finish;
+} pool_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+void initPool(pool_t *pool, int threads, poolJob_t job, poolSetup_t setup,
+	void *context);
+void runPool(pool_t *pool, int jobs);
+void freePool(pool_t *pool);
+
+#endif
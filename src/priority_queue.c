@@ -1,14 +1,14 @@
 #include "priority_queue.h"
 #include "utils.h"
+#include "memory.h"
 
 void heap_init(struct heap* h)
 {
-    int i;
 	h->count = 0;
 	h->size = initial_size;
-	h->heaparr = (node_t **) malloc(sizeof(node_t*) * initial_size);
-	for(i = 0; i < initial_size; i++)
-	    h->heaparr[i]=NULL;
+	// Large region, on transparent huge pages once it grows past one
+	h->heaparr = (frontier_t *) resizeLarge(NULL, 0, 
+		sizeof(frontier_t) * initial_size);
 	
 	if(!h->heaparr) {
 		printf("Error allocatinga memory...\n");
@@ -17,18 +17,18 @@ void heap_init(struct heap* h)
 
 }
 
-void max_heapify(node_t** data, int loc, int count) {
+void max_heapify(frontier_t* data, int loc, int count) {
 	int left, right, largest;
-	node_t* temp;
+	frontier_t temp;
 	left = 2*(loc) + 1;
 	right = left + 1;
 	largest = loc;
 	
 
-	if (left <= count && data[left]->priority > data[largest]->priority) {
+	if (left < count && data[left].priority > data[largest].priority) {
 		largest = left;
 	} 
-	if (right <= count && data[right]->priority > data[largest]->priority) {
+	if (right < count && data[right].priority > data[largest].priority) {
 		largest = right;
 	} 
 	
@@ -41,15 +41,16 @@ void max_heapify(node_t** data, int loc, int count) {
 
 }
 
-void heap_push(struct heap* h, node_t* value)
+void heap_push(struct heap* h, frontier_t value)
 {
 	int index, parent;
  
-	// Resize the heap if it is too small to hold all the data
+	// Double the heap if it is too small to hold all the data
 	if (h->count == h->size)
 	{
-		h->size += 1;
-		h->heaparr = realloc(h->heaparr, sizeof(node_t) * h->size);
+		h->heaparr = resizeLarge(h->heaparr, sizeof(frontier_t) * h->size, 
+			sizeof(frontier_t) * h->size * 2);
+		h->size *= 2;
 		if (!h->heaparr) exit(-1); // Exit if the memory allocation fails
 	}
  	
@@ -59,7 +60,7 @@ void heap_push(struct heap* h, node_t* value)
 	for(;index; index = parent)
 	{
 		parent = (index - 1) / 2;
-		if (h->heaparr[parent]->priority >= value->priority) break;
+		if (h->heaparr[parent].priority >= value.priority) break;
 		h->heaparr[index] = h->heaparr[parent];
 	}
 	h->heaparr[index] = value;
@@ -68,38 +69,32 @@ void heap_push(struct heap* h, node_t* value)
 void heap_display(struct heap* h) {
 	int i;
 	for(i=0; i<h->count; ++i) {
-	    node_t* n = h->heaparr[i];
+	    frontier_t n = h->heaparr[i];
 	    
-	    printf("priority = %d", n->priority);
+	    printf("priority = %d move = %d", n.priority, n.move);
 	    printf("\n");
-	    drawBoard( n->board, 0 );
+	    drawBoard( n.parent->board, 0 );
 	}
 }
 
-node_t* heap_delete(struct heap* h)
+frontier_t heap_delete(struct heap* h)
 {
-	node_t* removed;
-	node_t* temp = h->heaparr[--h->count];
- 	
-	
-	if ((h->count <= (h->size + 2)) && (h->size > initial_size))
-	{
-		h->size -= 1;
-		h->heaparr = realloc(h->heaparr, sizeof(node_t) * h->size);
-		if (!h->heaparr) exit(-1); // Exit if the memory allocation fails
-	}
- 	removed = h->heaparr[0];
- 	h->heaparr[0] = temp;
-	if(temp == removed) h->heaparr[0] = NULL;
+	frontier_t removed = h->heaparr[0];
+
+	// Keep the allocated size, the next search reuses it
+	h->heaparr[0] = h->heaparr[--h->count];
  	max_heapify(h->heaparr, 0, h->count);
  	return removed;
 }
 
 
 void emptyPQ(struct heap* pq) {
-	while(pq->count != 0) {
-		node_t* n = heap_delete(pq);
-		free(n);
-		//printf("<<%d", heap_delete(pq));
-	}
+	// Entries do not own their parent, nothing to free
+	pq->count = 0;
+}
+
+void heap_free(struct heap* h)
+{
+	freeLarge(h->heaparr, sizeof(frontier_t) * h->size, BACKINGS);
+	h->heaparr = NULL;
 }
@@ -10,29 +10,30 @@
 #include "node.h"
 
 /**
- * size is the allocated size, count is the number of elements in the queue
+ * size is the allocated size, count is the number of elements in the queue,
+ * entries are stored by value so pushing does not allocate a node
  */
 
 struct heap {
 	int size;
 	int count;
-	node_t** heaparr;
+	frontier_t* heaparr;
 };
 
-int *heap, size, count;
-
 #define initial_size  4
 
 void heap_init(struct heap* h);
 
-void max_heapify(node_t** data, int loc, int count);
+void max_heapify(frontier_t* data, int loc, int count);
 
-void heap_push(struct heap* h, node_t* value);
+void heap_push(struct heap* h, frontier_t value);
 
 void heap_display(struct heap* h);
 
-node_t* heap_delete(struct heap* h);
+frontier_t heap_delete(struct heap* h);
 
 void emptyPQ(struct heap* pq);
 
+void heap_free(struct heap* h);
+
 #endif
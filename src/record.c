@@ -0,0 +1,270 @@
+/*
+ ============================================================================
+ Name        : record.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Compact binary game records, streaming writer and replay
+ ============================================================================
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "record.h"
+#include "ai.h"
+#include "metrics.h"
+
+/*****************************ENCODING*FUNCTION******************************/
+
+/** Store a little endian 32 bits integer
+ */
+static void
+putU32(uint8_t *out, uint32_t value) {
+	out[0] = value;
+	out[1] = value >> 8;
+	out[2] = value >> 16;
+	out[3] = value >> 24;
+}
+
+/** Load a little endian 32 bits integer
+ */
+static uint32_t
+getU32(const uint8_t *in) {
+	return in[0] | (uint32_t) in[1] << 8 | (uint32_t) in[2] << 16 | 
+		(uint32_t) in[3] << 24;
+}
+
+/*****************************WRITER*FUNCTION********************************/
+
+/** Write the whole buffer to the file
+ * @param recorder Writer to be flushed
+ */
+static void
+flushRecorder(recorder_t *recorder) {
+	int done = 0;
+
+	while (done < recorder -> used) {
+		ssize_t n = write(recorder -> fd, recorder -> buffer + done, 
+			recorder -> used - done);
+		assert(n > 0);
+		done += n;
+	}
+
+	recorder -> offset += recorder -> used;
+	recorder -> used = 0;
+}
+
+/** Append bytes through the buffer
+ * @param recorder Writer of the file
+ * @param data Bytes to be written
+ * @param n Number of bytes
+ */
+static void
+appendBytes(recorder_t *recorder, const uint8_t *data, int n) {
+	if (recorder -> used + n > RECORD_BUFFER) {
+		flushRecorder(recorder);
+	}
+
+	memcpy(recorder -> buffer + recorder -> used, data, n);
+	recorder -> used += n;
+}
+
+/** Open a record file, new games are appended to it
+ * @param recorder Writer to be initialized
+ * @param path Record file
+ * @return bool False if the file can not be opened
+ */
+bool
+openRecorder(recorder_t *recorder, const char *path) {
+	recorder -> fd = open(path, O_WRONLY | O_CREAT, 0644);
+	if (recorder -> fd < 0) {
+		return false;
+	}
+
+	recorder -> offset = lseek(recorder -> fd, 0, SEEK_END);
+	recorder -> used = 0;
+	recorder -> turns = 0;
+	return true;
+}
+
+/** Start a game, turns and score are patched by endGame
+ * @param recorder Writer of the file
+ * @param seed Seed of the spawns of the game
+ * @param max_depth Maximum depth of the search
+ * @param propagation Type of propagation
+ * @param flags RECORD_STATS or 0
+ * @param board Initial board
+ */
+void
+beginGame(recorder_t *recorder, uint32_t seed, int max_depth, 
+	propagation_t propagation, uint8_t flags, uint8_t board[SIZE][SIZE]) {
+	uint8_t header[RECORD_HEADER];
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, RECORD_MAGIC, 4);
+	header[4] = RECORD_VERSION;
+	header[5] = flags;
+	header[6] = max_depth;
+	header[7] = propagation;
+	putU32(header + HEADER_SEED, seed);
+	memcpy(header + HEADER_BOARD, board, SIZE * SIZE);
+
+	recorder -> header = recorder -> offset + recorder -> used;
+	recorder -> turns = 0;
+	recorder -> flags = flags;
+	appendBytes(recorder, header, RECORD_HEADER);
+}
+
+/** Record one turn, the spawn is found by comparing the board after the
+ * move with the board after the spawn
+ * @param recorder Writer of the file
+ * @param move Move played
+ * @param before Board after the move, before the spawn
+ * @param after Board after the spawn
+ * @param expanded Expanded nodes of the search of this turn
+ * @param latency Wall time of the search of this turn in microseconds
+ */
+void
+recordTurn(recorder_t *recorder, move_t move, uint8_t before[SIZE][SIZE], 
+	uint8_t after[SIZE][SIZE], uint32_t expanded, uint32_t latency) {
+	uint8_t turn[RECORD_TURN_STATS];
+	int i, j;
+
+	turn[0] = move & MOVE_BITS;
+	for (i = 0; i < SIZE; i ++) {
+		for (j = 0; j < SIZE; j++) {
+			if (before[i][j] != after[i][j]) {
+				turn[0] |= (i * SIZE + j) << CELL_SHIFT;
+				turn[0] |= (after[i][j] == SPAWN_HIGH) << FOUR_SHIFT;
+			}
+		}
+	}
+
+	if (recorder -> flags & RECORD_STATS) {
+		putU32(turn + 1, expanded);
+		putU32(turn + 5, latency);
+		appendBytes(recorder, turn, RECORD_TURN_STATS);
+	}
+	else {
+		appendBytes(recorder, turn, RECORD_TURN);
+	}
+
+	recorder -> turns ++;
+}
+
+/** Finish the game, the header gets its number of turns and score
+ * @param recorder Writer of the file
+ * @param score Final score
+ */
+void
+endGame(recorder_t *recorder, uint32_t score) {
+	uint8_t patch[HEADER_BOARD - HEADER_TURNS];
+
+	putU32(patch, recorder -> turns);
+	putU32(patch + HEADER_SCORE - HEADER_TURNS, score);
+
+	// The header might still be in the buffer
+	if (recorder -> header >= recorder -> offset) {
+		memcpy(recorder -> buffer + (recorder -> header - 
+			recorder -> offset) + HEADER_TURNS, patch, sizeof(patch));
+	}
+	else {
+		flushRecorder(recorder);
+		ssize_t n = pwrite(recorder -> fd, patch, sizeof(patch), 
+			recorder -> header + HEADER_TURNS);
+		assert(n == sizeof(patch));
+	}
+}
+
+/** Flush and close the record file
+ * @param recorder Writer of the file
+ */
+void
+closeRecorder(recorder_t *recorder) {
+	flushRecorder(recorder);
+	close(recorder -> fd);
+}
+
+/*****************************REPLAY*FUNCTION********************************/
+
+/** Replay every game of a record file through execute_move_t and check 
+ * that every move is legal and that the final score matches
+ * @param path Record file
+ * @return int Exit status
+ */
+int
+replayRecords(const char *path) {
+	uint8_t board[SIZE][SIZE];
+	uint64_t turns = 0, expanded = 0;
+	uint32_t score, t, nTurns;
+	int games = 0, bad = 0;
+	struct stat info;
+	size_t at = 0;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+		fprintf(stderr, "can not read record %s\n", path);
+		if (fd >= 0) close(fd);
+		return EXIT_FAILURE;
+	}
+
+	const uint8_t *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, 
+		fd, 0);
+	assert(data != MAP_FAILED);
+	madvise((void *) data, info.st_size, MADV_SEQUENTIAL);
+
+	double start = wallClock();
+	while (at + RECORD_HEADER <= (size_t) info.st_size && 
+		memcmp(data + at, RECORD_MAGIC, 4) == 0) {
+		const uint8_t *header = data + at;
+		int size = header[5] & RECORD_STATS ? RECORD_TURN_STATS : RECORD_TURN;
+		bool valid = header[4] == RECORD_VERSION;
+
+		nTurns = getU32(header + HEADER_TURNS);
+		memcpy(board, header + HEADER_BOARD, SIZE * SIZE);
+		at += RECORD_HEADER;
+		if (at + (size_t) nTurns * size > (size_t) info.st_size) {
+			break;
+		}
+
+		score = 0;
+		for (t = 0; t < nTurns && valid; t ++, at += size) {
+			uint8_t turn = data[at];
+			int cell = (turn >> CELL_SHIFT) & CELL_BITS;
+
+			valid = execute_move_t(board, &score, turn & MOVE_BITS) && 
+				board[cell / SIZE][cell % SIZE] == 0;
+			board[cell / SIZE][cell % SIZE] = (turn >> FOUR_SHIFT) & 1 ? 
+				SPAWN_HIGH : SPAWN_LOW;
+			if (size == RECORD_TURN_STATS) {
+				expanded += getU32(data + at + 1);
+			}
+		}
+		at += (size_t) (nTurns - t) * size;
+
+		turns += nTurns;
+		games ++;
+		if (!valid || score != getU32(header + HEADER_SCORE)) {
+			bad ++;
+		}
+	}
+	double end = wallClock();
+
+	printf("games      %d (%d invalid)\n", games, bad);
+	printf("turns      %llu\n", (unsigned long long) turns);
+	if (expanded) {
+		printf("expanded   %llu\n", (unsigned long long) expanded);
+	}
+	printf("time       %.3f s\n", end - start);
+	printf("turns/s    %.0f\n", turns / (end - start));
+	printf("MB/s       %.1f\n", at / (end - start) / MICROSECOND);
+	if (at != (size_t) info.st_size) {
+		printf("trailing   %zu bytes not replayed\n", info.st_size - at);
+		bad ++;
+	}
+
+	munmap((void *) data, info.st_size);
+	close(fd);
+	return bad ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/*
+ ============================================================================
+ Name        : record.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Compact binary game records, streaming writer and replay
+ ============================================================================
+ */
+
+#ifndef __RECORD__
+#define __RECORD__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * A record file is a sequence of games, each one is a RECORD_HEADER bytes
+ * header followed by one record per turn, every integer is little endian
+ *
+ * header: "2048" version flags max_depth propagation seed(u32) turns(u32)
+ *         score(u32) initial board (SIZE * SIZE exponents)
+ * turn:   move (bit 0-1) | spawn cell (bit 2-5) | spawn is a 4 (bit 6),
+ *         then expanded(u32) latency_us(u32) if RECORD_STATS is set
+ */
+#define RECORD_MAGIC "2048"
+#define RECORD_VERSION 1
+#define RECORD_STATS 1 // flag, every turn carries its search statistics
+#define HEADER_SEED 8
+#define HEADER_TURNS 12
+#define HEADER_SCORE 16
+#define HEADER_BOARD 20
+#define RECORD_HEADER (HEADER_BOARD + SIZE * SIZE)
+#define RECORD_TURN 1
+#define RECORD_TURN_STATS (RECORD_TURN + 8)
+#define RECORD_BUFFER (1 << 16) // bytes buffered before each write()
+#define MOVE_BITS 0x3
+#define CELL_SHIFT 2
+#define CELL_BITS 0xf
+#define FOUR_SHIFT 6
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Streaming writer appending games to a record file
+ */
+typedef struct recorder_s {
+	int fd;
+	uint8_t buffer[RECORD_BUFFER];
+	int used;
+	off_t offset; // file offset of the end of buffer
+	off_t header; // file offset of the header of the current game
+	uint32_t turns;
+	uint8_t flags;
+} recorder_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+bool openRecorder(recorder_t *recorder, const char *path);
+void beginGame(recorder_t *recorder, uint32_t seed, int max_depth, 
+	propagation_t propagation, uint8_t flags, uint8_t board[SIZE][SIZE]);
+void recordTurn(recorder_t *recorder, move_t move, 
+	uint8_t before[SIZE][SIZE], uint8_t after[SIZE][SIZE], 
+	uint32_t expanded, uint32_t latency);
+void endGame(recorder_t *recorder, uint32_t score);
+void closeRecorder(recorder_t *recorder);
+
+int replayRecords(const char *path);
+
+#endif
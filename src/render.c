@@ -0,0 +1,153 @@
+/*
+ ============================================================================
+ Name        : render.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Diff based, rate limited terminal renderer of the board
+ ============================================================================
+ */
+
+#include <stdarg.h>
+
+#include "render.h"
+#include "metrics.h"
+#include "ai.h"
+
+/*****************************FRAME*FUNCTION*********************************/
+
+/** Append formatted text to the frame
+ * @param renderer Renderer owning the frame
+ * @param format Format as printf
+ */
+static void
+appendFrame(renderer_t *renderer, const char *format, ...) {
+	va_list args;
+
+	va_start(args, format);
+	int n = vsnprintf(renderer -> frame + renderer -> length, 
+		FRAME_BUFFER - renderer -> length, format, args);
+	va_end(args);
+
+	assert(n >= 0 && renderer -> length + n < FRAME_BUFFER);
+	renderer -> length += n;
+}
+
+/** Append the CELL_HEIGHT lines of one cell, as drawBoard draws it
+ * @param renderer Renderer owning the frame
+ * @param value Exponent of the cell
+ * @param x Column of the cell
+ * @param y Row of the cell
+ */
+static void
+appendCell(renderer_t *renderer, uint8_t value, int x, int y) {
+	char color[COLOR_LENGTH], s[12];
+	int line;
+
+	getColor(value, color, COLOR_LENGTH);
+	for (line = 0; line < CELL_HEIGHT; line ++) {
+		// Terminal rows and columns start at 1
+		appendFrame(renderer, "\033[%d;%dH%s", BOARD_ROW + y * CELL_HEIGHT + 
+			line, 1 + x * CELL_WIDTH, color);
+		if (line != CELL_HEIGHT / 2) {
+			appendFrame(renderer, "       ");
+		}
+		else if (value != 0) {
+			snprintf(s, 12, "%u", (uint32_t) 1 << value);
+			int t = CELL_WIDTH - strlen(s);
+			appendFrame(renderer, "%*s%s%*s", t - t / 2, "", s, t / 2, "");
+		}
+		else {
+			appendFrame(renderer, "   ·   ");
+		}
+		appendFrame(renderer, "\033[m");
+	}
+}
+
+/*****************************RENDER*FUNCTION********************************/
+
+/** Initialize a renderer, nothing is on screen yet
+ * @param renderer Renderer to be initialized
+ * @param enabled False to never draw (--no-render)
+ * @param fps Maximum frames per second, UNLIMITED_FPS for no cap
+ */
+void
+initRenderer(renderer_t *renderer, bool enabled, int fps) {
+	renderer -> enabled = enabled;
+	renderer -> valid = false;
+	renderer -> interval = fps > UNLIMITED_FPS ? 1.0 / fps : 0;
+	renderer -> last = 0;
+	renderer -> length = 0;
+}
+
+/** Forget what is on screen, the next frame is drawn in full. Used after
+ * anything else (drawBoard, prompts) wrote to the terminal
+ * @param renderer Renderer of the terminal
+ */
+void
+invalidateRenderer(renderer_t *renderer) {
+	renderer -> valid = false;
+}
+
+/** Draw the board with a single write(), only the cells and score that 
+ * changed since the previous frame are emitted. The cursor is left where
+ * drawBoard leaves it, on the help line
+ * @param renderer Renderer of the terminal
+ * @param board Board to be drawn
+ * @param score Score to be drawn
+ * @param force Draw even if the frame rate cap would skip it
+ */
+void
+renderFrame(renderer_t *renderer, uint8_t board[SIZE][SIZE], 
+	uint32_t score, bool force) {
+	int x, y, done = 0;
+
+	if (!renderer -> enabled) {
+		return;
+	}
+
+	// Skipped frames keep the previous state, so the next diff is right
+	double now = wallClock();
+	if (!force && renderer -> valid && now - renderer -> last < 
+		renderer -> interval) {
+		return;
+	}
+
+	renderer -> length = 0;
+	if (!renderer -> valid) {
+		appendFrame(renderer, "\033[H\033[2J");
+	}
+
+	if (!renderer -> valid || score != renderer -> score) {
+		appendFrame(renderer, "\033[1;1H2048.c %17d pts", score);
+	}
+
+	for (y = 0; y < SIZE; y ++) {
+		for (x = 0; x < SIZE; x ++) {
+			if (!renderer -> valid || board[x][y] != renderer -> board[x][y]) {
+				appendCell(renderer, board[x][y], x, y);
+			}
+		}
+	}
+
+	if (!renderer -> valid) {
+		appendFrame(renderer, "\033[%d;1H        ←,↑,→,↓ or q        ", 
+			BOARD_ROW + SIZE * CELL_HEIGHT + 1);
+	}
+	appendFrame(renderer, "\033[%d;1H", BOARD_ROW + SIZE * CELL_HEIGHT + 1);
+
+	// Anything printed with stdio must reach the terminal first
+	fflush(stdout);
+	while (done < renderer -> length) {
+		ssize_t n = write(STDOUT_FILENO, renderer -> frame + done, 
+			renderer -> length - done);
+		if (n <= 0) {
+			break;
+		}
+		done += n;
+	}
+
+	copyBoard(renderer -> board, board);
+	renderer -> score = score;
+	renderer -> valid = true;
+	renderer -> last = now;
+}
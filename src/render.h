@@ -0,0 +1,47 @@
+/*
+ ============================================================================
+ Name        : render.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Diff based, rate limited terminal renderer of the board
+ ============================================================================
+ */
+
+#ifndef __RENDER__
+#define __RENDER__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+#define FRAME_BUFFER 16384 // enough for a full frame of every cell
+#define CELL_WIDTH 7
+#define CELL_HEIGHT 3
+#define BOARD_ROW 3 // terminal row of the first cell, after score and blank
+#define COLOR_LENGTH 40
+#define UNLIMITED_FPS 0
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * What is currently on screen, frames only redraw the cells that differ
+ */
+typedef struct renderer_s {
+	bool enabled;
+	bool valid; // false until a full frame has been drawn
+	double interval; // minimum seconds between two frames, 0 is unlimited
+	double last; // wall time of the latest frame
+	uint8_t board[SIZE][SIZE];
+	uint32_t score;
+	char frame[FRAME_BUFFER];
+	int length;
+} renderer_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+void initRenderer(renderer_t *renderer, bool enabled, int fps);
+void invalidateRenderer(renderer_t *renderer);
+void renderFrame(renderer_t *renderer, uint8_t board[SIZE][SIZE], 
+	uint32_t score, bool force);
+
+#endif
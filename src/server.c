@@ -0,0 +1,431 @@
+/*
+ ============================================================================
+ Name        : server.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Batched move query service over a Unix domain socket
+ ============================================================================
+ */
+
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "ai.h"
+#include "pool.h"
+#include "kernel.h"
+#include "metrics.h"
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Statistics since the server started
+ */
+typedef struct serverStats_s {
+	uint64_t batches;
+	uint64_t boards;
+	uint64_t expanded;
+	double busy; // seconds spent answering batches
+	metrics_t latency; // wall time of every batch
+} serverStats_t;
+
+/**
+ * Bytes received from a client that do not make a whole request yet
+ */
+typedef struct client_s {
+	uint8_t *data;
+	size_t length;
+	size_t capacity;
+} client_t;
+
+/**
+ * Batch shared with the worker pool, job i answers board i
+ */
+typedef struct batch_s {
+	const uint8_t *boards;
+	uint8_t *reply;
+	int depth;
+	propagation_t propagation;
+	const kernel_t *kernel; // kernel of depth and propagation, or NULL
+	uint64_t expanded;
+	size_t memory; // peak bytes of a search of the batch
+	bool degraded;
+} batch_t;
+
+/** Cleared by SIGINT or SIGTERM to stop the server */
+static volatile sig_atomic_t running = 1;
+
+/*****************************IO*FUNCTION************************************/
+
+/** Stop the server loop at the next poll
+ */
+static void
+stopServer(int signum) {
+	running = 0;
+}
+
+/** Read every byte a client has sent so far without blocking, at most one
+ * whole request of the largest batch is buffered
+ * @param fd Client socket, non blocking
+ * @param client Buffer of the client
+ * @return bool False on end of file or error
+ */
+static bool
+readAvailable(int fd, client_t *client) {
+	size_t largest = SERVER_REQUEST + SERVER_MAX_BATCH * SERVER_BOARD;
+
+	while (true) {
+		if (client -> length == client -> capacity) {
+			if (client -> capacity >= largest) {
+				return true;
+			}
+			client -> capacity = client -> capacity ? 
+				client -> capacity * 2 : SERVER_BUFFER;
+			client -> data = (uint8_t *) realloc(client -> data, 
+				client -> capacity);
+			assert(client -> data != NULL);
+		}
+
+		ssize_t got = read(fd, client -> data + client -> length, 
+			client -> capacity - client -> length);
+		if (got > 0) {
+			client -> length += got;
+		}
+		else if (got < 0 && errno == EINTR) {
+			continue;
+		}
+		else {
+			return got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+		}
+	}
+}
+
+/** Write exactly n bytes, waiting at most SERVER_TIMEOUT ms each time the
+ * client does not read
+ * @return bool False on error or timeout
+ */
+static bool
+writeFull(int fd, const uint8_t *data, size_t n) {
+	struct pollfd out = {fd, POLLOUT, 0};
+
+	while (n > 0) {
+		ssize_t done = write(fd, data, n);
+		if (done > 0) {
+			data += done;
+			n -= done;
+		}
+		else if (done < 0 && errno == EINTR) {
+			continue;
+		}
+		else if (done < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (poll(&out, 1, SERVER_TIMEOUT) <= 0) {
+				return false;
+			}
+		}
+		else {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Little endian helpers of the protocol
+ */
+static uint32_t
+loadU32(const uint8_t *in) {
+	return in[0] | (uint32_t) in[1] << 8 | (uint32_t) in[2] << 16 | 
+		(uint32_t) in[3] << 24;
+}
+
+static void
+storeU32(uint8_t *out, uint32_t value) {
+	out[0] = value;
+	out[1] = value >> 8;
+	out[2] = value >> 16;
+	out[3] = value >> 24;
+}
+
+/*****************************WORKER*FUNCTION********************************/
+
+/** Job of the pool, answers one board of the batch with the kernel of the
+ * batch if there is one, ties are broken from the board so the answer does
+ * not depend on the worker
+ * @param context Batch being answered
+ * @param i Index of the board in the batch
+ */
+static void
+answerBoard(void *context, int i) {
+	batch_t *batch = (batch_t *) context;
+	const uint8_t *in = batch -> boards + i * SERVER_BOARD;
+	uint8_t *out = batch -> reply + sizeof(uint32_t) + i * SERVER_ANSWER;
+	uint64_t packed = loadU32(in) | (uint64_t) loadU32(in + 4) << 32;
+	int generated = 0, expanded = 0, pruned = 0, m;
+	uint32_t values[NUMBER_OF_MOVES];
+	uint8_t board[SIZE][SIZE];
+	uint8_t legal;
+	move_t move;
+
+	unpackBoard(packed, board);
+	setTieBreak(hashBoard(board) | 1);
+	if (batch -> kernel != NULL) {
+		legal = legalMoves(board);
+		move = batch -> kernel -> searchMove(board, values, &generated, 
+			&expanded, &pruned);
+	}
+	else {
+		move = searchMove(board, batch -> depth, batch -> propagation, 
+			values, &legal, &generated, &expanded, &pruned);
+	}
+
+	out[0] = legal ? move : SERVER_NO_MOVE;
+	out[1] = legal;
+	out[2] = out[3] = 0;
+	for (m = 0; m < NUMBER_OF_MOVES; m ++) {
+		storeU32(out + 4 + m * sizeof(uint32_t), values[m]);
+	}
+
+	// Counters of the batch are shared by every worker
+	size_t memory = searchMemory(), peak = batch -> memory;
+	while (memory > peak && !__atomic_compare_exchange_n(&batch -> memory, 
+		&peak, memory, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+	__atomic_fetch_add(&batch -> expanded, expanded, __ATOMIC_RELAXED);
+	if (searchDegraded()) {
+		__atomic_store_n(&batch -> degraded, true, __ATOMIC_RELAXED);
+	}
+}
+
+/****************************REQUEST*FUNCTION********************************/
+
+/** Answer a statistics request
+ * @param fd Client socket
+ * @param stats Statistics of the server
+ * @return bool False if the client is gone
+ */
+static bool
+answerStats(int fd, serverStats_t *stats) {
+	uint8_t reply[sizeof(uint32_t) + SERVER_STATS];
+
+	int n = snprintf((char *) reply + sizeof(uint32_t), SERVER_STATS, 
+		"{\"batches\": %llu, \"boards\": %llu, \"expanded\": %llu, "
+		"\"busy_seconds\": %.6f, \"boards_per_second\": %.1f, "
+		"\"batch_latency_us\": {\"p50\": %.1f, \"p90\": %.1f, "
+		"\"p99\": %.1f, \"max\": %.1f}}", 
+		(unsigned long long) stats -> batches, 
+		(unsigned long long) stats -> boards, 
+		(unsigned long long) stats -> expanded, stats -> busy, 
+		stats -> busy > 0 ? stats -> boards / stats -> busy : 0, 
+		latencyPercentile(&stats -> latency, 50) * MICROSECOND, 
+		latencyPercentile(&stats -> latency, 90) * MICROSECOND, 
+		latencyPercentile(&stats -> latency, 99) * MICROSECOND, 
+		latencyPercentile(&stats -> latency, PERCENT) * MICROSECOND);
+	if (n >= SERVER_STATS) {
+		n = SERVER_STATS - 1;
+	}
+
+	storeU32(reply, n);
+	return writeFull(fd, reply, sizeof(uint32_t) + n);
+}
+
+/** Answer a batch of boards, searched by the pool and answered in one go
+ * @param fd Client socket
+ * @param boards Packed boards of the request
+ * @param count Number of boards
+ * @param depth Depth of the search, at least 1
+ * @param propagation Type of propagation, max or avg
+ * @param pool Pool of the server, its context is the batch
+ * @param stats Statistics of the server
+ * @return bool False if the client is gone
+ */
+static bool
+answerBatch(int fd, const uint8_t *boards, uint32_t count, int depth,
+	propagation_t propagation, pool_t *pool, serverStats_t *stats) {
+	batch_t *batch = (batch_t *) pool -> context;
+
+	uint8_t *reply = (uint8_t *) malloc(sizeof(uint32_t) + 
+		count * SERVER_ANSWER);
+	assert(reply != NULL);
+
+	batch -> boards = boards;
+	batch -> reply = reply;
+	batch -> depth = depth;
+	batch -> propagation = propagation;
+	batch -> kernel = findKernel(depth, propagation);
+	batch -> expanded = 0;
+	batch -> memory = 0;
+	batch -> degraded = false;
+
+	double start = wallClock();
+	storeU32(reply, count);
+	runPool(pool, count);
+	double seconds = wallClock() - start;
+
+	stats -> batches ++;
+	stats -> boards += count;
+	stats -> expanded += batch -> expanded;
+	stats -> busy += seconds;
+	recordMove(&stats -> latency, seconds, batch -> memory, 
+		batch -> degraded);
+
+	bool ok = writeFull(fd, reply, sizeof(uint32_t) + count * SERVER_ANSWER);
+	free(reply);
+	return ok;
+}
+
+/** Answer every whole request in the buffer of a client, a partial one 
+ * stays buffered until the rest arrives
+ * @param fd Client socket
+ * @param client Buffer of the client
+ * @param pool Pool of the server
+ * @param stats Statistics of the server
+ * @return bool False if the client is gone or sent a bad request
+ */
+static bool
+answerRequests(int fd, client_t *client, pool_t *pool, 
+	serverStats_t *stats) {
+	size_t offset = 0;
+	bool ok = true;
+
+	while (ok && client -> length - offset >= SERVER_REQUEST) {
+		const uint8_t *header = client -> data + offset;
+		uint32_t count = loadU32(header);
+		int depth = header[4];
+		propagation_t propagation = header[5] == avg ? avg : max;
+
+		if (count == 0) {
+			ok = answerStats(fd, stats);
+			offset += SERVER_REQUEST;
+			continue;
+		}
+
+		// Depth 0 would move randomly, maybe illegally
+		if (count > SERVER_MAX_BATCH || depth < 1 || 
+			depth > SERVER_MAX_DEPTH) {
+			return false;
+		}
+
+		size_t size = SERVER_REQUEST + (size_t) count * SERVER_BOARD;
+		if (client -> length - offset < size) {
+			break;
+		}
+
+		ok = answerBatch(fd, header + SERVER_REQUEST, count, depth,
+			propagation, pool, stats);
+		offset += size;
+	}
+
+	memmove(client -> data, client -> data + offset, 
+		client -> length - offset);
+	client -> length -= offset;
+	return ok;
+}
+
+/*****************************SERVER*FUNCTION********************************/
+
+/** Serve move queries on a Unix socket until SIGINT or SIGTERM. Requests
+ * of every client are answered one batch at a time once they are whole, 
+ * the boards of a batch are split over a pool of workers started once, 
+ * whose searches stay allocated between batches
+ * @param path Path of the socket, replaced if it exists
+ * @param threads Number of workers, at least 1
+ * @return int Exit status
+ */
+int
+serveMoves(const char *path, int threads) {
+	struct pollfd fds[SERVER_CLIENTS + 1];
+	client_t clients[SERVER_CLIENTS + 1];
+	struct sockaddr_un address;
+	struct sigaction action;
+	serverStats_t stats;
+	batch_t batch;
+	pool_t pool;
+	int nfds = 1;
+	int i;
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "socket path too long %s\n", path);
+		return EXIT_FAILURE;
+	}
+	strcpy(address.sun_path, path);
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(path);
+	if (listener < 0 || bind(listener, (struct sockaddr *) &address, 
+		sizeof(address)) != 0 || listen(listener, SERVER_BACKLOG) != 0) {
+		fprintf(stderr, "can not listen on %s\n", path);
+		return EXIT_FAILURE;
+	}
+
+	// Interrupt poll instead of restarting it, so the stats get printed
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopServer;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&stats, 0, sizeof(stats));
+	initMetrics(&stats.latency);
+	initPool(&pool, threads, answerBoard, NULL, &batch);
+
+	fds[0].fd = listener;
+	fds[0].events = POLLIN;
+	fprintf(stderr, "serving on %s with %d threads\n", path, threads);
+
+	while (running) {
+		if (poll(fds, nfds, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		// New client, refused when every slot is taken
+		if (fds[0].revents & POLLIN) {
+			int client = accept(listener, NULL, NULL);
+			if (client >= 0 && nfds <= SERVER_CLIENTS) {
+				fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+				memset(&clients[nfds], 0, sizeof(client_t));
+				fds[nfds].fd = client;
+				fds[nfds ++].events = POLLIN;
+			}
+			else if (client >= 0) {
+				close(client);
+			}
+		}
+
+		for (i = 1; i < nfds; i ++) {
+			if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+				// Whole requests sent before a hang up are still answered
+				bool open = readAvailable(fds[i].fd, &clients[i]);
+				if (!answerRequests(fds[i].fd, &clients[i], &pool, &stats) ||
+					!open) {
+					// Client gone, the last slot takes its place
+					close(fds[i].fd);
+					free(clients[i].data);
+					clients[i] = clients[nfds - 1];
+					fds[i --] = fds[-- nfds];
+				}
+			}
+		}
+	}
+
+	fprintf(stderr, "%llu batches, %llu boards, %.1f boards/s\n", 
+		(unsigned long long) stats.batches, (unsigned long long) stats.boards,
+		stats.busy > 0 ? stats.boards / stats.busy : 0);
+
+	for (i = 1; i < nfds; i ++) {
+		close(fds[i].fd);
+		free(clients[i].data);
+	}
+	close(listener);
+	unlink(path);
+	freeMetrics(&stats.latency);
+	freePool(&pool);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+/*
+ ============================================================================
+ Name        : server.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Batched move query service over a Unix domain socket
+ ============================================================================
+ */
+
+#ifndef __SERVER__
+#define __SERVER__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * Every integer is little endian, a connection can send any number of
+ * requests and gets one response for each, in order
+ *
+ * request:  count(u32) depth(u8) propagation(u8, 0 max 1 avg) reserved(u16)
+ *           then count boards packed as in packBoard (u64 each)
+ * response: count(u32) then for each board
+ *           move(u8, SERVER_NO_MOVE if game over) legal mask(u8) 
+ *           reserved(u16) value of left, right, up, down(u32 each)
+ *
+ * A request with count 0 asks for statistics, the response is a length
+ * (u32) followed by that many bytes of JSON. A request with depth 0 or
+ * above SERVER_MAX_DEPTH closes the connection. Client sockets are non 
+ * blocking, a partial request waits in the buffer of its client, and a 
+ * client that does not read its response within SERVER_TIMEOUT ms is 
+ * dropped
+ */
+#define SERVER_REQUEST 8
+#define SERVER_BOARD 8
+#define SERVER_ANSWER 20
+#define SERVER_NO_MOVE 0xff
+#define SERVER_MAX_BATCH 65536
+#define SERVER_MAX_DEPTH 10
+#define SERVER_CLIENTS 64
+#define SERVER_BACKLOG 16
+#define SERVER_STATS 512
+#define SERVER_BUFFER 4096 // initial buffer of a client
+#define SERVER_TIMEOUT 1000 // ms a response may wait for the client
+
+/****************************FUNCTION-DECLARATION****************************/
+
+int serveMoves(const char *path, int threads);
+
+#endif
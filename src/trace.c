@@ -0,0 +1,147 @@
+/*
+ ============================================================================
+ Name        : trace.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Scoped timeline events exported as Chrome trace JSON, only
+               compiled in with -DTRACE (make trace)
+ ============================================================================
+ */
+
+#include "trace.h"
+
+#ifdef TRACE
+
+#define NANO_PER_SECOND 1000000000ull
+#define NANO_PER_MICRO 1000.0
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * One complete event, time in nanoseconds of the monotonic clock
+ */
+typedef struct event_s {
+	const char *name;
+	uint64_t start;
+	uint64_t duration;
+	int arg;
+} event_t;
+
+/**
+ * Ring buffer owned by one thread, next is the total number of events
+ * recorded so the oldest one is at next % TRACE_CAPACITY once it wrapped
+ */
+typedef struct ring_s {
+	event_t *events;
+	uint64_t next;
+	int tid;
+} ring_t;
+
+/** Ring of the calling thread, created on its first event */
+static __thread ring_t *threadRing = NULL;
+
+/** Every ring ever created, read when the trace is written */
+static ring_t *rings[TRACE_THREADS];
+static int nRings = 0;
+
+/****************************TRACE*FUNCTION**********************************/
+
+/** Current time of the monotonic clock
+ * @return nanoseconds Nanoseconds since an arbitrary fixed point
+ */
+uint64_t
+traceClock() {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * NANO_PER_SECOND + now.tv_nsec;
+}
+
+/** Create and register the ring of the calling thread
+ * @return ring Ring of the calling thread, NULL if too many threads
+ */
+static ring_t
+*createRing() {
+	int index = __atomic_fetch_add(&nRings, 1, __ATOMIC_RELAXED);
+
+	if (index >= TRACE_THREADS) {
+		return NULL;
+	}
+
+	ring_t *ring = (ring_t *) malloc(sizeof(ring_t));
+	assert(ring != NULL);
+	ring -> events = (event_t *) malloc(sizeof(event_t) * TRACE_CAPACITY);
+	assert(ring -> events != NULL);
+	ring -> next = 0;
+	ring -> tid = index;
+
+	__atomic_store_n(&rings[index], ring, __ATOMIC_RELEASE);
+	return ring;
+}
+
+/** Record a complete event that ends now
+ * @param name Static name of the event
+ * @param start Start of the event from traceClock
+ * @param arg Argument shown with the event or TRACE_NO_ARG
+ */
+void
+traceRecord(const char *name, uint64_t start, int arg) {
+	uint64_t end = traceClock();
+
+	if (threadRing == NULL && (threadRing = createRing()) == NULL) {
+		return;
+	}
+
+	event_t *event = &threadRing -> events[threadRing -> next ++ % 
+		TRACE_CAPACITY];
+	event -> name = name;
+	event -> start = start;
+	event -> duration = end - start;
+	event -> arg = arg;
+}
+
+/** Write every ring as Chrome trace event JSON (chrome://tracing, Perfetto),
+ * should be called once the other threads stopped recording
+ * @param path File to be written
+ */
+void
+traceWrite(const char *path) {
+	int count = nRings < TRACE_THREADS ? nRings : TRACE_THREADS;
+	bool first = true;
+	uint64_t i, begin;
+	int r;
+
+	/** File open */
+	FILE *fp = fopen(path, "w");
+	assert(fp != NULL);
+
+	fprintf(fp, "{\"traceEvents\":[\n");
+	for (r = 0; r < count; r ++) {
+		ring_t *ring = __atomic_load_n(&rings[r], __ATOMIC_ACQUIRE);
+		if (ring == NULL) {
+			continue;
+		}
+
+		// Only the latest TRACE_CAPACITY events are still in the ring
+		begin = ring -> next > TRACE_CAPACITY ? ring -> next - TRACE_CAPACITY 
+			: 0;
+		for (i = begin; i < ring -> next; i ++) {
+			event_t *event = &ring -> events[i % TRACE_CAPACITY];
+			fprintf(fp, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+				"\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", first ? "" : ",\n", 
+				event -> name, ring -> tid, event -> start / NANO_PER_MICRO, 
+				event -> duration / NANO_PER_MICRO);
+			if (event -> arg != TRACE_NO_ARG) {
+				fprintf(fp, ",\"args\":{\"value\":%d}", event -> arg);
+			}
+			fprintf(fp, "}");
+			first = false;
+		}
+	}
+	fprintf(fp, "\n]}\n");
+
+	fclose(fp);
+}
+
+#endif
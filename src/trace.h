@@ -0,0 +1,47 @@
+/*
+ ============================================================================
+ Name        : trace.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Scoped timeline events exported as Chrome trace JSON, only
+               compiled in with -DTRACE (make trace)
+ ============================================================================
+ */
+
+#ifndef __TRACE__
+#define __TRACE__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+#define TRACE_CAPACITY (1 << 20) // events kept per thread, oldest overwritten
+#define TRACE_THREADS 64 // maximum number of threads with a ring buffer
+#define TRACE_NO_ARG -1
+
+/*****************************MACRO******************************************/
+
+/**
+ * TRACE_BEGIN(var) starts a scope, TRACE_END(var, name, arg) records it as
+ * one complete event, arg is shown in the trace (TRACE_NO_ARG to omit).
+ * Without -DTRACE every macro expands to nothing
+ */
+#ifdef TRACE
+#define TRACE_BEGIN(var) uint64_t var = traceClock()
+#define TRACE_END(var, name, arg) traceRecord(name, var, arg)
+#define TRACE_WRITE(path) traceWrite(path)
+#else
+#define TRACE_BEGIN(var)
+#define TRACE_END(var, name, arg)
+#define TRACE_WRITE(path)
+#endif
+
+/****************************FUNCTION-DECLARATION****************************/
+
+#ifdef TRACE
+uint64_t traceClock();
+void traceRecord(const char *name, uint64_t start, int arg);
+void traceWrite(const char *path);
+#endif
+
+#endif
@@ -0,0 +1,369 @@
+/*
+ ============================================================================
+ Name        : tune.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Tuning of the evaluation weights from seeded self play
+ ============================================================================
+ */
+
+#include "tune.h"
+#include "ai.h"
+#include "pool.h"
+#include "corpus.h"
+#include "metrics.h"
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Games of one iteration shared with the worker pool, job i is game
+ * i % games of candidate i / games so every candidate plays the same seeds
+ */
+typedef struct tune_s {
+	weights_t candidates[TUNE_CANDIDATES];
+	game_t *results;
+	int games;
+	int depth;
+	propagation_t propagation;
+	const kernel_t *kernel; // kernel of depth and propagation, or NULL
+	uint32_t seed; // seed of the games of the iteration
+	int jobs;
+} tune_t;
+
+/*****************************GAME*FUNCTION**********************************/
+
+/** Play a game with the search of this thread, spawns are drawn from the
+ * seed so that every configuration sees the same tiles for the same moves,
+ * and the tie breaks of every turn from the seed and the turn so that the
+ * game does not depend on the other threads or on what ran before it
+ * @param seed Seed of the spawns
+ * @param max_depth Maximum depth that will be expanded
+ * @param propagation Type of propagation, max or avg
+ * @param kernel Kernel of max_depth and propagation, NULL for the generic
+ * engine (both choose the same moves)
+ * @param result Outcome of the game
+ * @param numberOfExpandedNode Increased by the nodes of every search
+ */
+void
+playSeededGame(uint32_t seed, int max_depth, propagation_t propagation,
+	const kernel_t *kernel, game_t *result, int *numberOfExpandedNode) {
+	uint8_t board[SIZE][SIZE];
+	uint32_t first = seed;
+	int generated = 0, pruned = 0;
+
+	memset(board, 0, sizeof(board));
+	addRandomSeeded(board, &seed);
+	addRandomSeeded(board, &seed);
+	result -> score = 0;
+	result -> turns = 0;
+
+	while (!gameEnded(board)) {
+		setTieBreak(gameSeed(first, result -> turns));
+		move_t move = kernelMove(kernel, board, max_depth, propagation,
+			&generated, numberOfExpandedNode, &pruned);
+		if (execute_move_t(board, &result -> score, move)) {
+			addRandomSeeded(board, &seed);
+		}
+		result -> turns ++;
+	}
+
+	setTieBreak(0);
+	result -> maxTile = maximumTile(board);
+}
+
+/** Job of the pool, plays one game of the iteration with the weights of
+ * its candidate
+ * @param context Games shared with the other workers
+ * @param i Index of the job in the iteration
+ */
+static void
+tuneGame(void *context, int i) {
+	tune_t *tune = (tune_t *) context;
+	int expanded = 0;
+
+	setWeights(&tune -> candidates[i / tune -> games]);
+	playSeededGame(gameSeed(tune -> seed, i % tune -> games), tune -> depth,
+		tune -> propagation, tune -> kernel, &tune -> results[i], &expanded);
+}
+
+/**************************CHECKPOINT*FUNCTION*******************************/
+
+/** Read the checkpoint of an interrupted tuning, it only stands for a run
+ * with the same games, depth, mode and seed since they decide every game
+ * @param path Checkpoint file
+ * @param tune Games of the run, games, depth and propagation are set
+ * @param seed Seed of the run
+ * @param iteration Next iteration to be run
+ * @param theta Weights reached so far
+ * @return int 1 if read, 0 if there is none, -1 if it is not a checkpoint
+ * of this run
+ */
+static int
+readCheckpoint(const char *path, tune_t *tune, uint32_t seed, 
+	int *iteration, double theta[WEIGHTS]) {
+	char line[MAX_LINE], name[MAX_LINE], text[MAX_LINE];
+	int parameters = 0, i;
+	bool matches = true;
+
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		return 0;
+	}
+
+	bool header = fgets(line, MAX_LINE, fp) != NULL && 
+		strncmp(line, TUNE_HEADER, strlen(TUNE_HEADER)) == 0;
+	while (header && fgets(line, MAX_LINE, fp) != NULL) {
+		if (line[0] == '#' || 
+			sscanf(line, "%255s %255s", name, text) != 2) {
+			continue;
+		}
+		double value = atof(text);
+
+		if (strcmp(name, "iteration") == 0) {
+			*iteration = (int) value;
+		}
+		else if (strcmp(name, "games") == 0) {
+			matches &= (int) value == tune -> games;
+			parameters ++;
+		}
+		else if (strcmp(name, "depth") == 0) {
+			matches &= (int) value == tune -> depth;
+			parameters ++;
+		}
+		else if (strcmp(name, "mode") == 0) {
+			matches &= strcmp(text, tune -> propagation == avg ? "avg" : 
+				"max") == 0;
+			parameters ++;
+		}
+		else if (strcmp(name, "seed") == 0) {
+			matches &= (uint32_t) strtoul(text, NULL, 10) == seed;
+			parameters ++;
+		}
+		for (i = 0; i < WEIGHTS; i ++) {
+			if (strcmp(name, weightName[i]) == 0) {
+				theta[i] = value;
+			}
+		}
+	}
+
+	fclose(fp);
+	return header && matches && parameters == TUNE_PARAMETERS ? 1 : -1;
+}
+
+/** Write the checkpoint, written aside then renamed so an interruption
+ * leaves the previous checkpoint
+ * @param path Checkpoint file
+ * @param tune Games of the run
+ * @param seed Seed of the run
+ * @param iteration Next iteration to be run
+ * @param theta Weights reached so far
+ * @return bool False if it can not be written
+ */
+static bool
+writeCheckpoint(const char *path, tune_t *tune, uint32_t seed, 
+	int iteration, double theta[WEIGHTS]) {
+	char temporary[MAX_LINE];
+	int i;
+
+	snprintf(temporary, MAX_LINE, "%s.tmp", path);
+	FILE *fp = fopen(temporary, "w");
+	if (fp == NULL) {
+		return false;
+	}
+
+	fprintf(fp, TUNE_HEADER "\n");
+	fprintf(fp, "games %d\n", tune -> games);
+	fprintf(fp, "depth %d\n", tune -> depth);
+	fprintf(fp, "mode %s\n", tune -> propagation == avg ? "avg" : "max");
+	fprintf(fp, "seed %u\n", seed);
+	fprintf(fp, "iteration %d\n", iteration);
+	for (i = 0; i < WEIGHTS; i ++) {
+		fprintf(fp, "%s %.6f\n", weightName[i], theta[i]);
+	}
+
+	fclose(fp);
+	return rename(temporary, path) == 0;
+}
+
+/*****************************TUNE*FUNCTION**********************************/
+
+/** Nearest valid weight
+ * @param value Weight before rounding
+ * @return weight Rounded weight within [0, WEIGHT_MAX]
+ */
+static uint32_t
+roundWeight(double value) {
+	if (value < 0) {
+		return 0;
+	}
+	return value > WEIGHT_MAX ? WEIGHT_MAX : (uint32_t) (value + 0.5);
+}
+
+/** Mean score of the games of a candidate
+ * @param tune Games of the iteration
+ * @param candidate Index of the candidate
+ * @return mean Mean score
+ */
+static double
+meanScore(tune_t *tune, int candidate) {
+	double total = 0;
+	int i;
+
+	for (i = 0; i < tune -> games; i ++) {
+		total += tune -> results[candidate * tune -> games + i].score;
+	}
+
+	return total / tune -> games;
+}
+
+/** ./2048 tune <iterations> [--games n] [--depth n] [--mode max|avg]
+ * [--threads n] [--seed n] [--start file] [--checkpoint file] [--out file],
+ * runs SPSA on the weights, resuming from the checkpoint if it exists. The
+ * rounded weights are written to the output after every iteration
+ * @param argc Number of arguments
+ * @param argv Arguments, argv[1] is tune
+ * @return int Exit status
+ */
+int
+tuneWeights(int argc, char *argv[]) {
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int iterations = 0, first = 0, iteration, i;
+	uint32_t seed = TUNE_SEED;
+	const char *startPath = NULL, *checkpointPath = TUNE_CHECKPOINT;
+	const char *outPath = TUNE_OUTPUT;
+	weights_t weights = DEFAULT_WEIGHTS;
+	double theta[WEIGHTS];
+	int delta[WEIGHTS];
+	tune_t tune;
+	pool_t pool;
+
+	tune.games = TUNE_GAMES;
+	tune.depth = TUNE_DEPTH;
+	tune.propagation = max;
+	sscanf(argv[2], "%d", &iterations);
+	for (i = 3; i < argc; i ++) {
+		if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &tune.games);
+		}
+		else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &tune.depth);
+		}
+		else if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc) {
+			tune.propagation = strcmp(argv[++ i], "avg") == 0 ? avg : max;
+		}
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%d", &threads);
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			sscanf(argv[++ i], "%u", &seed);
+		}
+		else if (strcmp(argv[i], "--start") == 0 && i + 1 < argc) {
+			startPath = argv[++ i];
+		}
+		else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+			checkpointPath = argv[++ i];
+		}
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+			outPath = argv[++ i];
+		}
+		else {
+			fprintf(stderr, "unknown option %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (iterations < 1 || tune.games < 1 || tune.depth < 1) {
+		fprintf(stderr, "iterations, games and depth must be positive\n");
+		return EXIT_FAILURE;
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	if (startPath != NULL && !loadWeights(startPath, &weights)) {
+		fprintf(stderr, "can not read weights %s\n", startPath);
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < WEIGHTS; i ++) {
+		theta[i] = weights.weight[i];
+	}
+	int resumed = readCheckpoint(checkpointPath, &tune, seed, &first, theta);
+	if (resumed < 0) {
+		fprintf(stderr, "%s is not a checkpoint of a run with these games, "
+			"depth, mode and seed\n", checkpointPath);
+		return EXIT_FAILURE;
+	}
+	if (resumed > 0) {
+		fprintf(stderr, "resuming %s at iteration %d\n", checkpointPath,
+			first);
+	}
+
+	tune.kernel = findKernel(tune.depth, tune.propagation);
+	tune.jobs = TUNE_CANDIDATES * tune.games;
+	tune.results = (game_t *) malloc(sizeof(game_t) * tune.jobs);
+	assert(tune.results != NULL);
+	initPool(&pool, threads, tuneGame, NULL, &tune);
+
+	double start = wallClock();
+	for (iteration = first; iteration < iterations; iteration ++) {
+		double perturbation = TUNE_PERTURBATION /
+			pow(iteration + 1, TUNE_GAMMA);
+		double step = TUNE_STEP /
+			pow(iteration + 1 + TUNE_STABILITY, TUNE_ALPHA);
+
+		/* Direction and games only depend on the seed and the iteration,
+		 * so a resumed run continues as if it was never interrupted
+		 */
+		uint32_t state = gameSeed(seed, iteration);
+		for (i = 0; i < WEIGHTS; i ++) {
+			delta[i] = i == WEIGHT_SCORE ? 0 :
+				nextRandom(&state) & 1 ? 1 : -1;
+			tune.candidates[0].weight[i] = roundWeight(theta[i] +
+				perturbation * delta[i]);
+			tune.candidates[1].weight[i] = roundWeight(theta[i] -
+				perturbation * delta[i]);
+		}
+
+		tune.seed = nextRandom(&state);
+		runPool(&pool, tune.jobs);
+
+		// Relative difference, so the step does not depend on the score
+		double plus = meanScore(&tune, 0), minus = meanScore(&tune, 1);
+		double relative = (plus - minus) / (plus + minus < 1 ? 1 :
+			plus + minus);
+		for (i = 0; i < WEIGHTS; i ++) {
+			if (delta[i] != 0) {
+				theta[i] += step * relative / (perturbation * delta[i]);
+				theta[i] = theta[i] < 0 ? 0 : theta[i] > WEIGHT_MAX ?
+					WEIGHT_MAX : theta[i];
+			}
+			weights.weight[i] = roundWeight(theta[i]);
+		}
+
+		if (!writeCheckpoint(checkpointPath, &tune, seed, iteration + 1, 
+			theta)) {
+			fprintf(stderr, "can not write checkpoint %s\n", checkpointPath);
+		}
+		if (!saveWeights(outPath, &weights)) {
+			fprintf(stderr, "can not write weights %s\n", outPath);
+		}
+
+		fprintf(stderr, "iteration %d: %.0f vs %.0f,", iteration + 1, plus,
+			minus);
+		for (i = 0; i < WEIGHTS; i ++) {
+			fprintf(stderr, " %s %.2f", weightName[i], theta[i]);
+		}
+		fprintf(stderr, "\n");
+	}
+	double end = wallClock();
+	freePool(&pool);
+
+	int played = (iterations - first > 0 ? iterations - first : 0) *
+		tune.jobs;
+	fprintf(stderr, "%d games, %d threads, %.3f s, %.1f games/s, weights in "
+		"%s\n", played, threads, end - start, played / (end - start < EPSILON ?
+		EPSILON : end - start), outPath);
+
+	free(tune.results);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+/*
+ ============================================================================
+ Name        : tune.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Tuning of the evaluation weights from seeded self play
+ ============================================================================
+ */
+
+#ifndef __TUNE__
+#define __TUNE__
+
+#include "utils.h"
+#include "weights.h"
+#include "lockstep.h"
+#include "kernel.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * SPSA, every iteration plays the same seeded games with weights moved up
+ * and down along a random direction, then moves the weights along the
+ * relative score difference. The score weight is the unit and is not tuned
+ */
+#define TUNE_GAMES 32 // games per candidate and iteration
+#define TUNE_DEPTH 2
+#define TUNE_SEED 2048u
+#define TUNE_STEP 8.0 // a, step size of the weights
+#define TUNE_PERTURBATION 2.0 // c, distance of the candidates
+#define TUNE_STABILITY 10.0 // A, damps the first steps
+#define TUNE_ALPHA 0.602 // decay of the step size
+#define TUNE_GAMMA 0.101 // decay of the perturbation
+#define TUNE_CANDIDATES 2
+#define TUNE_HEADER "# 2048 tuning checkpoint"
+#define TUNE_PARAMETERS 4 // games, depth, mode and seed of a checkpoint
+#define TUNE_CHECKPOINT "tune.checkpoint"
+#define TUNE_OUTPUT "weights.txt"
+
+/****************************FUNCTION-DECLARATION****************************/
+
+void playSeededGame(uint32_t seed, int max_depth, propagation_t propagation,
+	const kernel_t *kernel, game_t *result, int *numberOfExpandedNode);
+int tuneWeights(int argc, char *argv[]);
+
+#endif
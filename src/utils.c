@@ -46,8 +46,8 @@ void drawBoard(uint8_t board[SIZE][SIZE], uint32_t score) {
 			getColor(board[x][y],color,40);
 			printf("%s",color);
 			if (board[x][y]!=0) {
-				char s[8];
-				snprintf(s,8,"%u",(uint32_t)1<<board[x][y]);
+				char s[12];
+				snprintf(s,12,"%u",(uint32_t)1<<board[x][y]);
 				uint8_t t = 7-strlen(s);
 				printf("%*s%s%*s",t-t/2,"",s,t/2,"");
 			} else {
@@ -188,38 +188,79 @@ uint8_t countEmpty(uint8_t board[SIZE][SIZE]) {
 }
 
 
-bool findPairDown(uint8_t board[SIZE][SIZE]) {
-	bool success = false;
-	uint8_t x,y;
+/**
+ * A line slides towards its first cell if a tile follows an empty cell or
+ * two equal tiles touch, and towards its last cell in the mirrored cases
+ */
+uint8_t legalMoves(uint8_t board[SIZE][SIZE]) {
+	uint8_t mask=0;
+	uint8_t x,y,a,b;
 	for (x=0;x<SIZE;x++) {
 		for (y=0;y<SIZE-1;y++) {
-			if (board[x][y]==board[x][y+1]) return true;
+			// Rows, up slides towards y = 0 and down towards SIZE - 1
+			a=board[x][y];
+			b=board[x][y+1];
+			if ((a==0 && b!=0) || (a!=0 && a==b)) mask|=1<<up;
+			if ((a!=0 && b==0) || (a!=0 && a==b)) mask|=1<<down;
+			// Columns, left slides towards x = 0 and right towards SIZE - 1
+			a=board[y][x];
+			b=board[y+1][x];
+			if ((a==0 && b!=0) || (a!=0 && a==b)) mask|=1<<left;
+			if ((a!=0 && b==0) || (a!=0 && a==b)) mask|=1<<right;
 		}
 	}
-	return success;
+	return mask;
 }
 
 bool gameEnded(uint8_t board[SIZE][SIZE]) {
-	bool ended = true;
-	if (countEmpty(board)>0) return false;
-	if (findPairDown(board)) return false;
-	rotateBoard(board);
-	if (findPairDown(board)) ended = false;
-	rotateBoard(board);
-	rotateBoard(board);
-	rotateBoard(board);
-	return ended;
+	return legalMoves(board)==0;
+}
+
+/**
+ * Each line is read from board in the order it slides, merged by slideArray
+ * and written to the successor, illegal moves are skipped from the mask
+ */
+uint8_t successorBoards(uint8_t board[SIZE][SIZE], 
+	uint8_t next[NUMBER_OF_MOVES][SIZE][SIZE], uint32_t gains[NUMBER_OF_MOVES]) {
+	uint8_t mask=legalMoves(board);
+	uint8_t line[SIZE];
+	uint8_t move,k,p,x,y;
+	for (move=left;move<=down;move++) {
+		if (!(mask>>move&1)) continue;
+		bool columns = move==left || move==right;
+		bool reversed = move==right || move==down;
+		gains[move]=0;
+		for (k=0;k<SIZE;k++) {
+			for (p=0;p<SIZE;p++) {
+				x = columns ? (reversed ? SIZE-1-p : p) : k;
+				y = columns ? k : (reversed ? SIZE-1-p : p);
+				line[p]=board[x][y];
+			}
+			slideArray(line,&gains[move]);
+			for (p=0;p<SIZE;p++) {
+				x = columns ? (reversed ? SIZE-1-p : p) : k;
+				y = columns ? k : (reversed ? SIZE-1-p : p);
+				next[move][x][y]=line[p];
+			}
+		}
+	}
+	return mask;
+}
+
+static bool initialized = false;
+
+void seedRandom(unsigned int seed) {
+	srand(seed);
+	initialized = true;
 }
 
 void addRandom(uint8_t board[SIZE][SIZE]) {
-	static bool initialized = false;
 	uint8_t x,y;
 	uint8_t r,len=0;
 	uint8_t n,list[SIZE*SIZE][2];
 
 	if (!initialized) {
-		srand(time(NULL));
-		initialized = true;
+		seedRandom(time(NULL));
 	}
 
 	for (x=0;x<SIZE;x++) {
@@ -241,6 +282,46 @@ void addRandom(uint8_t board[SIZE][SIZE]) {
 	}
 }
 
+/**
+ * xorshift32 step, state must never be zero
+ */
+uint32_t nextRandom(uint32_t *state) {
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+void addRandomSeeded(uint8_t board[SIZE][SIZE], uint32_t *state) {
+	uint8_t x,y;
+	uint8_t r,len=0;
+	uint8_t n,list[SIZE*SIZE][2];
+
+	if (*state == 0) {
+		*state = 1;
+	}
+
+	for (x=0;x<SIZE;x++) {
+		for (y=0;y<SIZE;y++) {
+			if (board[x][y]==0) {
+				list[len][0]=x;
+				list[len][1]=y;
+				len++;
+			}
+		}
+	}
+
+	if (len>0) {
+		r = nextRandom(state)%len;
+		x = list[r][0];
+		y = list[r][1];
+		n = (nextRandom(state)%10)/9+1;
+		board[x][y]=n;
+	}
+}
+
 void initBoard(uint8_t board[SIZE][SIZE], uint32_t* score) {
 	uint8_t x,y;
 	for (x=0;x<SIZE;x++) {
@@ -275,3 +356,19 @@ bool execute_move_t( uint8_t  board[SIZE][SIZE], uint32_t* score, move_t move){
 	return success;
 	
 }
+
+/**
+ * Number of bytes with an optional K, M or G suffix, 0 if it is not a size
+ */
+size_t parseBytes(const char *text) {
+	char *end;
+	double bytes = strtod(text, &end);
+	if (end == text || bytes < 0) return 0;
+	switch(*end)
+		{
+		case 'k': case 'K': bytes *= 1024.0;                   end ++; break;
+		case 'm': case 'M': bytes *= 1024.0 * 1024.0;          end ++; break;
+		case 'g': case 'G': bytes *= 1024.0 * 1024.0 * 1024.0; end ++; break;
+		}
+	return *end == '\0' ? (size_t) bytes : 0;
+}
@@ -16,6 +16,7 @@
 #define SIZE 4
 #define BASE 2
 #define EPSILON 0.01
+#define NUMBER_OF_MOVES 4 // left, right, up and down
 #define _XOPEN_SOURCE 500
 
 /**
@@ -33,19 +34,25 @@ typedef enum moves{
  */
 typedef enum propagation{
 	max=0,
-	avg=1
+	avg=1,
+	mcts=2 // rollouts backed up through a Monte Carlo tree
 } propagation_t;
 
 /** Used for printing output to output.txt */
 void
 printOutput(int max_depth, int numberOfGeneratedNode, int numberOfExpandedNode, 
-	double searchTime, uint8_t maxTile, uint32_t score);
+	int numberOfPrunedNode, double searchTime, uint8_t maxTile, uint32_t score);
 
 /**
  * Renders the board
  */
 void drawBoard(uint8_t board[SIZE][SIZE], uint32_t score);
 
+/**
+ * Escape sequence of the colors of a tile, for the current scheme
+ */
+void getColor(uint8_t value, char *color, size_t length);
+
 
 /**
  * Updates the board with each action, and updates the score
@@ -56,10 +63,29 @@ bool moveDown(uint8_t board[SIZE][SIZE], uint32_t* score);
 bool moveRight(uint8_t board[SIZE][SIZE], uint32_t* score);
 
 /**
- * Checks if game has ended
+ * Slides and merges one line towards its first cell, used by the moves
+ */
+bool slideArray(uint8_t array[SIZE], uint32_t* score);
+
+/**
+ * Checks if game has ended, no move is legal
  */
 bool gameEnded(uint8_t board[SIZE][SIZE]);
 
+/**
+ * Legal moves of a board, bit m set if move m changes it, found from every
+ * pair of neighbouring cells without moving anything
+ */
+uint8_t legalMoves(uint8_t board[SIZE][SIZE]);
+
+/**
+ * Every legal successor of a board in one pass, next[m] and gains[m] are only
+ * written for the moves of the returned mask and board is left as it is
+ */
+uint8_t successorBoards(uint8_t board[SIZE][SIZE], 
+	uint8_t next[NUMBER_OF_MOVES][SIZE][SIZE], 
+	uint32_t gains[NUMBER_OF_MOVES]);
+
 /**
 * Counts the number of empty cells
 */
@@ -76,10 +102,28 @@ uint32_t getTile( uint8_t board[SIZE][SIZE], unsigned i, unsigned j);
 void initBoard(uint8_t board[SIZE][SIZE], uint32_t* score);
 void addRandom(uint8_t board[SIZE][SIZE]);
 
+/**
+* Seed of addRandom, seeded from the time on first use otherwise
+*/
+void seedRandom(unsigned int seed);
+
+/**
+* Deterministic counterpart of addRandom, the tile is chosen from the given
+* random state (xorshift) instead of the global rand()
+*/
+uint32_t nextRandom(uint32_t *state);
+void addRandomSeeded(uint8_t board[SIZE][SIZE], uint32_t *state);
+
 /**
  * Executes an action, updates the board and the score, and return true if the board has changed,
  * and false otherwise
  */
 bool execute_move_t( uint8_t  board[SIZE][SIZE], uint32_t* score, move_t move);
 
+/**
+ * Parses a number of bytes with an optional K, M or G suffix (powers of 1024),
+ * returns 0 if it is not a size
+ */
+size_t parseBytes(const char *text);
+
 #endif
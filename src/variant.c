@@ -0,0 +1,85 @@
+/*
+ ============================================================================
+ Name        : variant.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Engines specialised at compile time for other board sizes
+ ============================================================================
+ */
+
+#include <math.h>
+
+#include "variant.h"
+#include "metrics.h"
+
+/*****************************SPECIALISATION*********************************/
+
+#define VARIANT_SIZE 3
+#include "variant_engine.h"
+#undef VARIANT_SIZE
+
+#define VARIANT_SIZE 5
+#include "variant_engine.h"
+#undef VARIANT_SIZE
+
+#define VARIANT_SIZE 6
+#include "variant_engine.h"
+#undef VARIANT_SIZE
+
+/** Every generated engine, the main engine handles SIZE */
+static const variant_t variants[] = {
+	{3, searchVariant3, executeVariant3, playVariant3},
+	{5, searchVariant5, executeVariant5, playVariant5},
+	{6, searchVariant6, executeVariant6, playVariant6},
+};
+
+/*****************************VARIANT*FUNCTION*******************************/
+
+/** Engine generated for a board size
+ * @param size Number of rows and columns
+ * @return variant Engine of that size, NULL if it was not generated
+ */
+const variant_t *
+findVariant(int size) {
+	size_t i;
+
+	for (i = 0; i < sizeof(variants) / sizeof(variants[0]); i ++) {
+		if (variants[i].size == size) {
+			return &variants[i];
+		}
+	}
+
+	return NULL;
+}
+
+/** Play one game on another board size without the terminal board, the
+ * result is written to output.txt as for the main engine
+ * @param size Number of rows and columns
+ * @param propagation Type of propagation, max or avg
+ * @param max_depth Maximum depth that will be expanded
+ * @param seed Seed of the spawns of the game
+ * @return int Exit status
+ */
+int
+playVariant(int size, propagation_t propagation, int max_depth, 
+	unsigned int seed) {
+	const variant_t *variant = findVariant(size);
+	variantResult_t result;
+
+	if (variant == NULL) {
+		fprintf(stderr, "no engine for %dx%d boards\n", size, size);
+		return EXIT_FAILURE;
+	}
+
+	seedRandom(seed);
+	variant -> playGame(propagation, max_depth, &result);
+
+	printf("%dx%d %s depth %d: score %u, max tile %d, %d moves, "
+		"%.0f nodes/s\n", size, size, propagation == max ? "max" : "avg", 
+		max_depth, result.score, (int) pow(BASE, result.maxTile), 
+		result.moves, result.expanded / fmax(result.searchTime, 1e-9));
+	printOutput(max_depth, result.generated, result.expanded, 0, 
+		result.searchTime, result.maxTile, result.score);
+
+	return EXIT_SUCCESS;
+}
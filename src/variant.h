@@ -0,0 +1,56 @@
+/*
+ ============================================================================
+ Name        : variant.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Engines specialised at compile time for other board sizes
+ ============================================================================
+ */
+
+#ifndef __VARIANT__
+#define __VARIANT__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * Sizes generated from variant_engine.h, SIZE itself keeps the main engine
+ */
+#define VARIANT_MAX_SIZE 6
+
+/*****************************STRUCTURE**************************************/
+
+/**
+ * Outcome of one game played by a variant engine
+ */
+typedef struct variantResult_s {
+	uint32_t score;
+	uint8_t maxTile;
+	int moves;
+	int generated;
+	int expanded;
+	double searchTime;
+} variantResult_t;
+
+/**
+ * Entry points of the engine of one size, boards are passed as size * size 
+ * row-major cells so that callers do not depend on the size
+ */
+typedef struct variant_s {
+	int size;
+	move_t (*searchMove)(uint8_t *cells, int max_depth, 
+		propagation_t propagation, uint32_t values[NUMBER_OF_MOVES], 
+		int *generated, int *expanded);
+	bool (*executeMove)(uint8_t *cells, uint32_t *score, move_t move);
+	void (*playGame)(propagation_t propagation, int max_depth, 
+		variantResult_t *result);
+} variant_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+const variant_t *findVariant(int size);
+int playVariant(int size, propagation_t propagation, int max_depth, 
+	unsigned int seed);
+
+#endif
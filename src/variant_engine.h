@@ -0,0 +1,383 @@
+/*
+ ============================================================================
+ Name        : variant_engine.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Engine template, included by variant.c once per board size
+ ============================================================================
+ */
+
+/**
+ * Included with VARIANT_SIZE defined, every function gets the size appended
+ * to its name (moveVariant5, searchVariant5, ...). Loops run over the 
+ * constant VARIANT_SIZE so the row kernels are fully unrolled. The rules 
+ * are those of the main engine: slideArray merges, spawns derived from a
+ * hash of the board, priority is the score plus countEmpty of every level.
+ * The tree is walked depth first without pruning, avg is the exact mean
+ * where the main engine keeps a rounded running mean
+ */
+
+#ifndef VARIANT_SIZE
+#error "variant_engine.h needs VARIANT_SIZE"
+#endif
+
+#define N VARIANT_SIZE
+#define VARIANT_PASTE(name, size) name ## size
+#define VARIANT_EXPAND(name, size) VARIANT_PASTE(name, size)
+#define VARIANT_NAME(name) VARIANT_EXPAND(name, VARIANT_SIZE)
+
+/* Packed rows, 4 bits per cell while tiles stay small enough (2^15 can not
+ * be reached on 3x3 and 4x4), 5 bits per cell on the larger boards
+ */
+#if N <= 4
+#define VARIANT_CELL_BITS 4
+typedef uint16_t VARIANT_NAME(row_t);
+#else
+#define VARIANT_CELL_BITS 5
+typedef uint32_t VARIANT_NAME(row_t);
+#endif
+
+/**
+ * Board of this size packed one row per word
+ */
+typedef struct {
+	VARIANT_NAME(row_t) row[N];
+} VARIANT_NAME(packed_t);
+
+/** Pack every row of the board
+ * @param board Board to be packed
+ * @return packed Rows with cell j in bits j * VARIANT_CELL_BITS
+ */
+static inline VARIANT_NAME(packed_t)
+VARIANT_NAME(packVariant)(uint8_t board[N][N]) {
+	VARIANT_NAME(packed_t) packed;
+	int i, j;
+
+	for (i = 0; i < N; i ++) {
+		packed.row[i] = 0;
+		#pragma GCC unroll 8
+		for (j = N - 1; j >= 0; j --) {
+			packed.row[i] = packed.row[i] << VARIANT_CELL_BITS | board[i][j];
+		}
+	}
+
+	return packed;
+}
+
+/** Hash of the board (FNV-1a over the packed rows), seeds the spawn
+ * @param board Board to be hashed
+ * @return hash Hash of the board
+ */
+static inline uint32_t
+VARIANT_NAME(hashVariant)(uint8_t board[N][N]) {
+	VARIANT_NAME(packed_t) packed = VARIANT_NAME(packVariant)(board);
+	uint32_t hash = 2166136261u;
+	int i;
+
+	#pragma GCC unroll 8
+	for (i = 0; i < N; i ++) {
+		hash = (hash ^ packed.row[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+/** Slide and merge one line towards its first cell, each tile merges once
+ * @param line Cells of the line, updated in place
+ * @param score Score increased by every merge
+ * @return bool True if the line changed
+ */
+static inline bool
+VARIANT_NAME(slideVariant)(uint8_t line[N], uint32_t *score) {
+	uint8_t out[N] = {0};
+	bool mergeable = false; // last tile of out has not merged yet
+	bool changed = false;
+	int i, o = 0;
+
+	#pragma GCC unroll 8
+	for (i = 0; i < N; i ++) {
+		if (line[i] == 0) {
+			continue;
+		}
+		if (mergeable && out[o - 1] == line[i]) {
+			out[o - 1] ++;
+			*score += (uint32_t) 1 << out[o - 1];
+			mergeable = false;
+		}
+		else {
+			out[o ++] = line[i];
+			mergeable = true;
+		}
+	}
+
+	#pragma GCC unroll 8
+	for (i = 0; i < N; i ++) {
+		changed |= out[i] != line[i];
+		line[i] = out[i];
+	}
+
+	return changed;
+}
+
+/** Apply a move, same orientation as execute_move_t (up slides every 
+ * board[i] towards board[i][0], left every board[.][j] towards board[0][j])
+ * @param board Board to be moved
+ * @param score Score increased by every merge
+ * @param move Move to be applied
+ * @return bool True if the board changed
+ */
+static inline bool
+VARIANT_NAME(moveVariant)(uint8_t board[N][N], uint32_t *score, move_t move) {
+	uint8_t line[N];
+	bool success = false;
+	int i, k;
+
+	for (i = 0; i < N; i ++) {
+		#pragma GCC unroll 8
+		for (k = 0; k < N; k ++) {
+			line[k] = move == up ? board[i][k] : move == down ? 
+				board[i][N - 1 - k] : move == left ? board[k][i] : 
+				board[N - 1 - k][i];
+		}
+		if (!VARIANT_NAME(slideVariant)(line, score)) {
+			continue;
+		}
+		success = true;
+		#pragma GCC unroll 8
+		for (k = 0; k < N; k ++) {
+			if (move == up) board[i][k] = line[k];
+			else if (move == down) board[i][N - 1 - k] = line[k];
+			else if (move == left) board[k][i] = line[k];
+			else board[N - 1 - k][i] = line[k];
+		}
+	}
+
+	return success;
+}
+
+/** Number of empty cells
+ * @param board Board to be counted
+ * @return count Empty cells
+ */
+static inline int
+VARIANT_NAME(countEmptyVariant)(uint8_t board[N][N]) {
+	int i, j, count = 0;
+
+	for (i = 0; i < N; i ++) {
+		#pragma GCC unroll 8
+		for (j = 0; j < N; j ++) {
+			count += board[i][j] == 0;
+		}
+	}
+
+	return count;
+}
+
+/** Whether no move is possible, no empty cell and no equal neighbours
+ * @param board Board to be checked
+ * @return bool True if the game is over
+ */
+static bool
+VARIANT_NAME(gameEndedVariant)(uint8_t board[N][N]) {
+	int i, j;
+
+	for (i = 0; i < N; i ++) {
+		for (j = 0; j < N; j ++) {
+			if (board[i][j] == 0 || 
+				(j + 1 < N && board[i][j] == board[i][j + 1]) ||
+				(i + 1 < N && board[i][j] == board[i + 1][j])) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/** Spawn a 2 (90%) or a 4 on a random empty cell
+ * @param board Board that receives the tile
+ * @param state Random state, xorshift if not NULL, rand() otherwise
+ */
+static void
+VARIANT_NAME(addRandomVariant)(uint8_t board[N][N], uint32_t *state) {
+	uint8_t list[N * N];
+	int i, len = 0;
+
+	if (state != NULL && *state == 0) {
+		*state = 1;
+	}
+
+	for (i = 0; i < N * N; i ++) {
+		if (board[i / N][i % N] == 0) {
+			list[len ++] = i;
+		}
+	}
+
+	if (len > 0) {
+		i = list[(state != NULL ? nextRandom(state) : rand()) % len];
+		board[i / N][i % N] = ((state != NULL ? nextRandom(state) : rand()) 
+			% 10) / 9 + 1;
+	}
+}
+
+/** Expand every move of a node and its subtree until max_depth
+ * @param board Board of the node
+ * @param priority Priority of the node
+ * @param depth Depth of the node
+ * @param max_depth Maximum depth that will be expanded
+ * @param best Greatest priority of the subtree
+ * @param sum Sum of the priorities of the subtree
+ * @param count Number of nodes of the subtree
+ * @param generated Calculate total number of generated node
+ */
+static void
+VARIANT_NAME(expandVariant)(uint8_t board[N][N], uint32_t priority, 
+	int depth, int max_depth, uint32_t *best, uint64_t *sum, 
+	uint64_t *count, int *generated) {
+	uint8_t child[N][N];
+	int move;
+
+	for (move = left; move <= down; move ++) {
+		uint32_t score = priority;
+		memcpy(child, board, sizeof(child));
+		(*generated) ++;
+		if (!VARIANT_NAME(moveVariant)(child, &score, move)) {
+			continue;
+		}
+
+		uint32_t seed = VARIANT_NAME(hashVariant)(child);
+		VARIANT_NAME(addRandomVariant)(child, &seed);
+		score += VARIANT_NAME(countEmptyVariant)(child);
+
+		if (score > *best) {
+			*best = score;
+		}
+		*sum += score;
+		(*count) ++;
+
+		if (depth + 1 < max_depth) {
+			VARIANT_NAME(expandVariant)(child, score, depth + 1, max_depth, 
+				best, sum, count, generated);
+		}
+	}
+}
+
+/** Best move of the board, same values as get_next_move would give on
+ * this size with the default weights
+ * @param cells Board as N * N row-major cells
+ * @param max_depth Maximum depth that will be expanded
+ * @param propagation Type of propagation, max or avg
+ * @param values Value of every move, 0 if illegal (can be NULL)
+ * @param generated Calculate total number of generated node
+ * @param expanded Calculate total number of expanded node
+ * @return best_action Move that lead to highest score, left if none legal
+ */
+static move_t
+VARIANT_NAME(searchVariant)(uint8_t *cells, int max_depth, 
+	propagation_t propagation, uint32_t values[NUMBER_OF_MOVES], 
+	int *generated, int *expanded) {
+	uint8_t (*board)[N] = (uint8_t (*)[N]) cells;
+	uint8_t child[N][N];
+	uint32_t value[NUMBER_OF_MOVES] = {0}, top = 0;
+	int ties[NUMBER_OF_MOVES], nTies = 0, move;
+	bool legal[NUMBER_OF_MOVES] = {false};
+
+	if (max_depth == 0) {
+		return rand() % NUMBER_OF_MOVES;
+	}
+
+	(*expanded) ++;
+	for (move = left; move <= down; move ++) {
+		uint32_t score = 0, best;
+		uint64_t sum = 0, count = 0;
+		memcpy(child, board, sizeof(child));
+		(*generated) ++;
+		if (!VARIANT_NAME(moveVariant)(child, &score, move)) {
+			continue;
+		}
+
+		uint32_t seed = VARIANT_NAME(hashVariant)(child);
+		VARIANT_NAME(addRandomVariant)(child, &seed);
+		score += VARIANT_NAME(countEmptyVariant)(child);
+		best = score;
+
+		if (max_depth > 1) {
+			VARIANT_NAME(expandVariant)(child, score, 1, max_depth, &best, 
+				&sum, &count, generated);
+		}
+		*expanded += count + 1;
+
+		legal[move] = true;
+		value[move] = propagation == max ? best : count ? sum / count : score;
+		if (value[move] > top) {
+			top = value[move];
+		}
+	}
+
+	// Tie between the best moves is broken randomly, as bestAction
+	for (move = left; move <= down; move ++) {
+		if (legal[move] && value[move] == top) {
+			ties[nTies ++] = move;
+		}
+	}
+	if (values != NULL) {
+		memcpy(values, value, sizeof(value));
+	}
+
+	return nTies ? ties[rand() % nTies] : left;
+}
+
+/** Apply a move on a board given as cells
+ * @param cells Board as N * N row-major cells
+ * @param score Score increased by every merge
+ * @param move Move to be applied
+ * @return bool True if the board changed
+ */
+static bool
+VARIANT_NAME(executeVariant)(uint8_t *cells, uint32_t *score, move_t move) {
+	return VARIANT_NAME(moveVariant)((uint8_t (*)[N]) cells, score, move);
+}
+
+/** Play a whole game with the ai, rand() must already be seeded
+ * @param propagation Type of propagation, max or avg
+ * @param max_depth Maximum depth that will be expanded
+ * @param result Outcome of the game
+ */
+static void
+VARIANT_NAME(playVariant)(propagation_t propagation, int max_depth, 
+	variantResult_t *result) {
+	uint8_t board[N][N];
+	int i, j;
+
+	memset(board, 0, sizeof(board));
+	memset(result, 0, sizeof(variantResult_t));
+	VARIANT_NAME(addRandomVariant)(board, NULL);
+	VARIANT_NAME(addRandomVariant)(board, NULL);
+
+	while (!VARIANT_NAME(gameEndedVariant)(board)) {
+		double start = wallClock();
+		move_t move = VARIANT_NAME(searchVariant)((uint8_t *) board, 
+			max_depth, propagation, NULL, &result -> generated, 
+			&result -> expanded);
+		result -> searchTime += wallClock() - start;
+
+		if (VARIANT_NAME(moveVariant)(board, &result -> score, move)) {
+			VARIANT_NAME(addRandomVariant)(board, NULL);
+			result -> moves ++;
+		}
+	}
+
+	for (i = 0; i < N; i ++) {
+		for (j = 0; j < N; j ++) {
+			if (board[i][j] > result -> maxTile) {
+				result -> maxTile = board[i][j];
+			}
+		}
+	}
+}
+
+#undef N
+#undef VARIANT_CELL_BITS
+#undef VARIANT_PASTE
+#undef VARIANT_EXPAND
+#undef VARIANT_NAME
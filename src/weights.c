@@ -0,0 +1,78 @@
+/*
+ ============================================================================
+ Name        : weights.c
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Weights of the evaluation terms and their weight file
+ ============================================================================
+ */
+
+#include "weights.h"
+#include "corpus.h"
+
+/** Name of every term in the weight file */
+const char *weightName[WEIGHTS] = {"score", "empty", "monotonic"};
+
+/** Read a weight file, terms missing from the file are left unchanged
+ * @param path File to be read
+ * @param weights Weights to be updated
+ * @return bool False if the file can not be read or has a bad line
+ */
+bool
+loadWeights(const char *path, weights_t *weights) {
+	char line[MAX_LINE], name[MAX_LINE];
+	unsigned int value;
+	int i;
+
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		return false;
+	}
+
+	while (fgets(line, MAX_LINE, fp) != NULL) {
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+		if (sscanf(line, "%255s %u", name, &value) != 2 || 
+			value > WEIGHT_MAX) {
+			fclose(fp);
+			return false;
+		}
+
+		for (i = 0; i < WEIGHTS && strcmp(name, weightName[i]) != 0; i ++);
+		if (i == WEIGHTS) {
+			fclose(fp);
+			return false;
+		}
+		weights -> weight[i] = value;
+	}
+
+	fclose(fp);
+	return true;
+}
+
+/** Write a weight file, written aside then renamed so a reader never sees
+ * half a file
+ * @param path File to be written
+ * @param weights Weights to be saved
+ * @return bool False if the file can not be written
+ */
+bool
+saveWeights(const char *path, weights_t *weights) {
+	char temporary[MAX_LINE];
+	int i;
+
+	snprintf(temporary, MAX_LINE, "%s.tmp", path);
+	FILE *fp = fopen(temporary, "w");
+	if (fp == NULL) {
+		return false;
+	}
+
+	fprintf(fp, "# 2048 evaluation weights, <term> <weight>\n");
+	for (i = 0; i < WEIGHTS; i ++) {
+		fprintf(fp, "%s %u\n", weightName[i], weights -> weight[i]);
+	}
+
+	fclose(fp);
+	return rename(temporary, path) == 0;
+}
@@ -0,0 +1,43 @@
+/*
+ ============================================================================
+ Name        : weights.h
+ Author      : Maleakhi Agung Wijaya <maleakhiw>
+ StudentID   : 784091
+ Description : Weights of the evaluation terms and their weight file
+ ============================================================================
+ */
+
+#ifndef __WEIGHTS__
+#define __WEIGHTS__
+
+#include "utils.h"
+
+/*****************************CONSTANT***************************************/
+
+/**
+ * Priority of a child is the priority of its parent plus every term times
+ * its weight. Weights are non negative integers so the priority stays exact
+ * and the branch and bound upper bound stays admissible. A weight file has
+ * one "<term> <weight>" per line, # starts a comment, missing terms keep
+ * their default
+ */
+#define WEIGHT_SCORE 0 // merge score of the move
+#define WEIGHT_EMPTY 1 // empty cells after the spawn
+#define WEIGHT_MONOTONIC 2 // rows and columns whose tiles are monotonic
+#define WEIGHTS 3
+#define WEIGHT_MAX 4096
+#define DEFAULT_WEIGHTS {{1, 1, 0}}
+
+/*****************************STRUCTURE**************************************/
+
+typedef struct weights_s {
+	uint32_t weight[WEIGHTS];
+} weights_t;
+
+/****************************FUNCTION-DECLARATION****************************/
+
+extern const char *weightName[WEIGHTS];
+bool loadWeights(const char *path, weights_t *weights);
+bool saveWeights(const char *path, weights_t *weights);
+
+#endif